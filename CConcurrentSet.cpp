@@ -0,0 +1,221 @@
+/*
+* File: CConcurrentSet.cpp
+* Brief description: CConcurrentSet class implementation
+* Details: File contain thread-safe set container with lock-free membership reads.
+* Author: Martin Bezecny
+*/
+
+#include <utility>
+
+#include "CConcurrentSet.h"
+#include "CEntity_CDouble.h"
+#include "CEntity_TPoint.h"
+
+// Internal functions
+
+/*
+ * Guard of read section
+ * Details: counts the reader in its slot, so writers do not free nodes and tables, which the reader can still walk
+ */
+class CReadGuard {
+    std::atomic<uint32_t>& iActive; ///< Counter of the reader slot
+
+public:
+    explicit CReadGuard(std::atomic<uint32_t>& aActive) : iActive(aActive) {
+        iActive.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence of Reclaim(): either writer sees the reader, or the reader sees the unlink
+    }
+    ~CReadGuard() { iActive.fetch_sub(1, std::memory_order_release); }
+
+    CReadGuard(const CReadGuard&) = delete;
+    CReadGuard& operator=(const CReadGuard&) = delete;
+};
+
+// Definitions of class methods
+
+template <typename TElement>
+CConcurrentSetT<TElement>::TTable::TTable(size_t aBuckets) : iMask(aBuckets - 1), iBuckets(new std::atomic<TNode*>[aBuckets]) {
+    for (size_t i = 0; i < aBuckets; ++i) iBuckets[i].store(nullptr, std::memory_order_relaxed);
+}
+
+template <typename TElement>
+void CConcurrentSetT<TElement>::TRetired::Free() {
+    for (TNode* node : iNodes) delete node;
+    for (TTable* table : iTables) delete table;
+    iNodes.clear();
+    iTables.clear();
+    iIdle = 0;
+}
+
+template <typename TElement>
+uint64_t CConcurrentSetT<TElement>::Mix(const TValue& aValue) {
+    uint64_t h = static_cast<uint64_t>(aValue.Hash());
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template <typename TElement>
+typename CConcurrentSetT<TElement>::TReaderSlot& CConcurrentSetT<TElement>::ReaderSlot() const {
+    static std::atomic<size_t> threads{ 0 };
+    thread_local const size_t slot = threads.fetch_add(1, std::memory_order_relaxed) % KReaderSlots; // threads get slots in turn, so they share slot only above KReaderSlots threads
+    return iReaders[slot];
+}
+
+template <typename TElement>
+CConcurrentSetT<TElement>::CConcurrentSetT() : iShards(new TShard[KShards]), iReaders(new TReaderSlot[KReaderSlots]) {
+    for (size_t i = 0; i < KShards; ++i) iShards[i].iTable.store(new TTable(KInitialBuckets), std::memory_order_relaxed);
+}
+
+template <typename TElement>
+CConcurrentSetT<TElement>::CConcurrentSetT(const CSet& aSet) : CConcurrentSetT() {
+    for (const TValue& value : aSet) add(value);
+}
+
+template <typename TElement>
+CConcurrentSetT<TElement>::~CConcurrentSetT() {
+    for (size_t i = 0; i < KShards; ++i) {
+        TShard& shard = iShards[i];
+        TTable* table = shard.iTable.load(std::memory_order_relaxed);
+        for (size_t bucket = 0; bucket <= table->iMask; ++bucket) {
+            for (TNode* node = table->iBuckets[bucket].load(std::memory_order_relaxed); node != nullptr; ) {
+                TNode* next = node->iNext.load(std::memory_order_relaxed);
+                delete node;
+                node = next;
+            }
+        }
+        delete table;
+        shard.iOpen.Free();
+        shard.iWaiting.Free();
+    }
+}
+
+template <typename TElement>
+void CConcurrentSetT<TElement>::Grow(TShard& aShard) {
+    TTable* old = aShard.iTable.load(std::memory_order_relaxed);
+    TTable* table = new TTable(2 * (old->iMask + 1));
+    // published nodes are never relinked (reader could skip part of chain), new table gets copies
+    for (size_t bucket = 0; bucket <= old->iMask; ++bucket) {
+        for (TNode* node = old->iBuckets[bucket].load(std::memory_order_relaxed); node != nullptr; node = node->iNext.load(std::memory_order_relaxed)) {
+            std::atomic<TNode*>& head = table->iBuckets[Mix(node->iValue) & table->iMask];
+            head.store(new TNode(node->iValue, head.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+            aShard.iOpen.iNodes.push_back(node);
+        }
+    }
+    aShard.iTable.store(table, std::memory_order_release);
+    aShard.iOpen.iTables.push_back(old);
+}
+
+template <typename TElement>
+void CConcurrentSetT<TElement>::Reclaim(TShard& aShard) const {
+    if (aShard.iWaiting.Empty()) {
+        if (aShard.iOpen.Empty()) {
+            aShard.iPending.store(false, std::memory_order_relaxed);
+            return;
+        }
+        std::swap(aShard.iWaiting, aShard.iOpen);
+        aShard.iWaiting.iIdle = 0;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence of CReadGuard
+    for (size_t i = 0; i < KReaderSlots; ++i) {
+        if (!(aShard.iWaiting.iIdle & (uint64_t(1) << i)) && iReaders[i].iActive.load(std::memory_order_acquire) == 0) aShard.iWaiting.iIdle |= uint64_t(1) << i;
+    }
+    if (aShard.iWaiting.iIdle == ~uint64_t(0)) aShard.iWaiting.Free();
+    aShard.iPending.store(!aShard.iWaiting.Empty() || !aShard.iOpen.Empty(), std::memory_order_relaxed);
+}
+
+template <typename TElement>
+void CConcurrentSetT<TElement>::TryReclaim(TShard& aShard) const {
+    if (!aShard.iPending.load(std::memory_order_relaxed)) return; // readers only read the flag, while nothing waits for reclamation
+    std::unique_lock<std::mutex> lock(aShard.iLock, std::try_to_lock);
+    if (lock.owns_lock()) Reclaim(aShard);
+}
+
+template <typename TElement>
+template <typename TFunc>
+void CConcurrentSetT<TElement>::ForEach(TFunc aFunc) const {
+    CReadGuard guard(ReaderSlot().iActive);
+    for (size_t i = 0; i < KShards; ++i) {
+        const TTable* table = iShards[i].iTable.load(std::memory_order_acquire);
+        for (size_t bucket = 0; bucket <= table->iMask; ++bucket) {
+            for (const TNode* node = table->iBuckets[bucket].load(std::memory_order_acquire); node != nullptr; node = node->iNext.load(std::memory_order_acquire)) aFunc(node->iValue);
+        }
+    }
+}
+
+template <typename TElement>
+size_t CConcurrentSetT<TElement>::num_of_elements() const {
+    size_t count = 0;
+    for (size_t i = 0; i < KShards; ++i) {
+        count += iShards[i].iCount.load(std::memory_order_relaxed);
+        TryReclaim(iShards[i]);
+    }
+    return count;
+}
+
+template <typename TElement>
+bool CConcurrentSetT<TElement>::add(const TValue& aVal) {
+    uint64_t hash = Mix(aVal);
+    TShard& shard = ShardOf(hash);
+    std::lock_guard<std::mutex> lock(shard.iLock);
+    TTable* table = shard.iTable.load(std::memory_order_relaxed);
+    std::atomic<TNode*>& head = table->iBuckets[hash & table->iMask];
+    for (TNode* node = head.load(std::memory_order_relaxed); node != nullptr; node = node->iNext.load(std::memory_order_relaxed)) {
+        if (node->iValue == aVal) return false;
+    }
+    head.store(new TNode(aVal, head.load(std::memory_order_relaxed)), std::memory_order_release);
+    if (shard.iCount.fetch_add(1, std::memory_order_relaxed) + 1 > table->iMask + 1) Grow(shard);
+    Reclaim(shard);
+    return true;
+}
+
+template <typename TElement>
+bool CConcurrentSetT<TElement>::erase(const TValue& aVal) {
+    uint64_t hash = Mix(aVal);
+    TShard& shard = ShardOf(hash);
+    std::lock_guard<std::mutex> lock(shard.iLock);
+    TTable* table = shard.iTable.load(std::memory_order_relaxed);
+    std::atomic<TNode*>* link = &table->iBuckets[hash & table->iMask];
+    for (TNode* node = link->load(std::memory_order_relaxed); node != nullptr; node = link->load(std::memory_order_relaxed)) {
+        if (node->iValue == aVal) {
+            // reader standing on the node still continues by its iNext, so the node is only unlinked and freed after grace period
+            link->store(node->iNext.load(std::memory_order_relaxed), std::memory_order_release);
+            shard.iCount.fetch_sub(1, std::memory_order_relaxed);
+            shard.iOpen.iNodes.push_back(node);
+            Reclaim(shard);
+            return true;
+        }
+        link = &node->iNext;
+    }
+    return false;
+}
+
+template <typename TElement>
+bool CConcurrentSetT<TElement>::is_element_of(const TValue& aVal) const {
+    uint64_t hash = Mix(aVal);
+    TShard& shard = ShardOf(hash);
+    bool found = false;
+    {
+        CReadGuard guard(ReaderSlot().iActive);
+        const TTable* table = shard.iTable.load(std::memory_order_acquire);
+        for (const TNode* node = table->iBuckets[hash & table->iMask].load(std::memory_order_acquire); node != nullptr && !found; node = node->iNext.load(std::memory_order_acquire)) found = node->iValue == aVal;
+    }
+    TryReclaim(shard); // outside of read section, so the slot of this reader may be seen idle
+    return found;
+}
+
+template <typename TElement>
+CSetT<TElement> CConcurrentSetT<TElement>::snapshot() const {
+    CSet result;
+    ForEach([&](const TValue& aValue) { result.add(CEntity(aValue)); });
+    for (size_t i = 0; i < KShards; ++i) TryReclaim(iShards[i]);
+    return result;
+}
+
+// Explicit instantiations for supported value types (see TSetTraits)
+
+template class CConcurrentSetT<CEntity_CDouble::CDouble>;
+template class CConcurrentSetT<CEntity_TPoint::TPoint>;
@@ -0,0 +1,218 @@
+#ifndef __CConcurrentSet_H__
+#define __CConcurrentSet_H__
+/*
+*  File: CConcurrentSet.h
+*  Brief: CConcurrentSet class header
+*  Details: File contain thread-safe set container with lock-free membership reads.
+*  Author: Martin Bezecny
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "CSet.h"
+
+/*
+ * CConcurrentSetT class
+ * Details: Values are spread over shards by hash, every shard is chained hash table with its own writer lock, so writers of different shards
+ * do not wait for each other. Readers take no lock and write no shared cache line except the counter of their reader slot:
+ * nodes are immutable after publication, chains are linked by atomic pointers, so reader always walks consistent chain.
+ * Unlinked nodes and replaced tables are not freed at once, they are retired and freed after grace period (RCU-like),
+ * when every reader slot was seen idle, so no reader can hold them anymore. Retiring writer never waits for readers.
+ * Grace period is checked by writers of the shard and, while it is pending, also by readers leaving their read section (only when they get
+ * the writer lock without waiting), so retired memory is freed even when the shard is not modified any more.
+ * Values are matched by operator== (tolerance of CSet is not supported).
+ * Methods can be called from any threads, except constructor, destructor and assignment.
+ * Element type is template parameter as in CSetT, member functions are defined in CConcurrentSet.cpp and instantiated there for both supported types.
+ */
+template <typename TElement>
+class CConcurrentSetT
+	{
+public:
+    using CSet = CSetT<TElement>; ///< Type of ordinary sets
+    using CEntity = typename CSet::CEntity; ///< Node class of the set
+    using TValue = TElement; ///< Type of stored values
+
+private:
+    static constexpr size_t KShards = 64; ///< Number of shards (power of two)
+    static constexpr size_t KReaderSlots = 64; ///< Number of reader slots (at most 64, seen slots are kept in bitmask)
+    static constexpr size_t KInitialBuckets = 16; ///< Number of buckets of new table (power of two)
+
+    /*
+    * Node of chain
+    */
+    struct TNode {
+        const TValue iValue; ///< Stored value, never modified after publication
+        std::atomic<TNode*> iNext; ///< Next node of the chain
+
+        TNode(const TValue& aValue, TNode* aNext) : iValue(aValue), iNext(aNext) {}
+    };
+
+    /*
+    * Table of buckets
+    */
+    struct TTable {
+        size_t iMask; ///< Number of buckets - 1
+        std::unique_ptr<std::atomic<TNode*>[]> iBuckets; ///< Heads of chains
+
+        explicit TTable(size_t aBuckets);
+    };
+
+    /*
+    * Nodes and tables waiting for the end of grace period
+    */
+    struct TRetired {
+        std::vector<TNode*> iNodes; ///< Unlinked nodes
+        std::vector<TTable*> iTables; ///< Replaced tables
+        uint64_t iIdle = 0; ///< Bitmask of reader slots seen idle since the start of grace period
+
+        bool Empty() const { return iNodes.empty() && iTables.empty(); }
+        void Free();
+    };
+
+    /*
+    * Shard of the set
+    */
+    struct alignas(64) TShard {
+        std::mutex iLock; ///< Lock of writers
+        std::atomic<TTable*> iTable; ///< Published table
+        std::atomic<size_t> iCount{ 0 }; ///< Number of values
+        TRetired iOpen; ///< Retired since the start of the current grace period (guarded by iLock)
+        TRetired iWaiting; ///< Retired before the start of the current grace period (guarded by iLock)
+        std::atomic<bool> iPending{ false }; ///< Some nodes or tables wait for reclamation (written under iLock)
+    };
+
+    /*
+    * Reader slot, padded to own cache line
+    */
+    struct alignas(64) TReaderSlot {
+        std::atomic<uint32_t> iActive{ 0 }; ///< Number of readers inside of read section
+    };
+
+    std::unique_ptr<TShard[]> iShards; ///< Shards
+    mutable std::unique_ptr<TReaderSlot[]> iReaders; ///< Reader slots
+
+    /*
+    * Method: Mix
+    * Return: mixed hash of the value, high bits select the shard, low bits the bucket
+    */
+    static uint64_t Mix(const TValue& aValue);
+
+    /*
+    * Method: Shard of value
+    * Return: shard holding the value
+    */
+    TShard& ShardOf(uint64_t aHash) const { return iShards[aHash >> 58]; }
+
+    /*
+    * Method: Reader slot
+    * Return: reader slot of the calling thread
+    */
+    TReaderSlot& ReaderSlot() const;
+
+    /*
+    * Method: Grow
+    * Details: publishes new table of twice as many buckets with copies of all nodes, the old table and nodes are retired (called under iLock)
+    * Parameters: aShard is grown shard
+    */
+    void Grow(TShard& aShard);
+
+    /*
+    * Method: Reclaim
+    * Details: checks idle reader slots and frees retired nodes and tables, when grace period ended (called under iLock)
+    * Parameters: aShard is reclaimed shard
+    */
+    void Reclaim(TShard& aShard) const;
+
+    /*
+    * Method: Try reclaim
+    * Details: reclaims the shard when some memory waits for reclamation and the writer lock is free, it never waits (called outside of read section)
+    * Parameters: aShard is reclaimed shard
+    */
+    void TryReclaim(TShard& aShard) const;
+
+    /*
+    * Method: For each value
+    * Parameters: aFunc is callable with const TValue& parameter called for every value
+    */
+    template <typename TFunc>
+    void ForEach(TFunc aFunc) const;
+
+public:
+    /*
+    * Method: C'tor
+    * Details: creates empty set
+    */
+    CConcurrentSetT();
+
+    /*
+    * Method: C'tor
+    * Details: creates set with values of given set
+    * Parameters: aSet is copied set
+    */
+    explicit CConcurrentSetT(const CSet& aSet);
+
+    CConcurrentSetT(const CConcurrentSetT&) = delete;
+    CConcurrentSetT& operator=(const CConcurrentSetT&) = delete;
+
+    /*
+    * Method: D'tor
+    * Details: frees all nodes and tables, no thread may use the set any more
+    */
+    ~CConcurrentSetT();
+
+    /*
+    * Method: Number of elements
+    * Details: while writers run, the result is count at some moment of the call, pending reclamation of shards is attempted too
+    * Return: number of values in the set
+    */
+    size_t num_of_elements() const;
+
+    /*
+    * Method: Add element
+    * Details: adds new value, when it is not present yet
+    * Parameters: aVal is added element
+    * Return: true when the value was added
+    */
+    bool add(const TValue& aVal);
+    bool add(const CEntity& aVal) { return add(aVal.Value()); }
+
+    /*
+    * Method: Erase element
+    * Parameters: aVal is erased element
+    * Return: true when the value was present and erased
+    */
+    bool erase(const TValue& aVal);
+    bool erase(const CEntity& aVal) { return erase(aVal.Value()); }
+
+    /*
+    * Method: Is element of
+    * Details: lock-free, the result reflects some moment of the call
+    * Parameters: aVal is searched element
+    * Return: true when the value is present
+    */
+    bool is_element_of(const TValue& aVal) const;
+    bool is_element_of(const CEntity& aVal) const { return is_element_of(aVal.Value()); }
+
+    /*
+    * Method: Snapshot
+    * Details: copies values into ordinary set, values added or erased during the copy may be missed, pending reclamation of shards is attempted after the copy
+    * Return: set with values of this set (in no particular order)
+    */
+    CSet snapshot() const;
+	}; /* class CConcurrentSetT */
+
+/*
+ * CConcurrentSet type
+ * Concurrent set of the CEntity variant selected in CEntity.h
+ */
+using CConcurrentSet = CConcurrentSetT<CSet::TValue>;
+
+extern template class CConcurrentSetT<CEntity_CDouble::CDouble>;
+extern template class CConcurrentSetT<CEntity_TPoint::TPoint>;
+
+#endif /* __CConcurrentSet_H__ */
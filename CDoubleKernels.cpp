@@ -0,0 +1,260 @@
+/*
+* File: CDoubleKernels.cpp
+* Brief description: CDoubleKernels class implementation
+* Details: File contain vectorized loops over arrays of doubles, which are used by CSet of CEntity_CDouble values and by columns of CEntity_TPoint coordinates.
+* Author: Martin Bezecny
+*/
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CDOUBLEKERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CDOUBLEKERNELS_TARGET(aIsa)
+#else
+#define CDOUBLEKERNELS_TARGET(aIsa) __attribute__((target(aIsa)))
+#endif
+#endif
+
+#include "CDoubleKernels.h"
+
+using TIsa = CDoubleKernels::TIsa;
+using TCompare = CDoubleKernels::TCompare;
+
+// Internal functions
+
+/*
+ * Kernels of one instruction set
+ */
+struct TKernels {
+    TIsa iIsa; ///< Instruction set of kernels
+    void (*iNegate)(double*, size_t); ///< Negation
+    void (*iCompare[4])(const double*, size_t, double, uint64_t*); ///< Comparisons with bound indexed by TCompare
+    uint64_t (*iContains)(const double*, size_t, const double*, size_t); ///< Batch membership
+    void (*iWithin)(const double*, const double*, const double*, size_t, const double*, double, uint64_t*); ///< Points within radius
+};
+
+template <TCompare KCompare>
+static bool Test(double aValue, double aBound) {
+    if constexpr (KCompare == TCompare::Less) return aValue < aBound;
+    else if constexpr (KCompare == TCompare::LessEqual) return aValue <= aBound;
+    else if constexpr (KCompare == TCompare::Greater) return aValue > aBound;
+    else return aValue >= aBound;
+}
+
+static void NegateScalar(double* aValues, size_t aCount) {
+    for (size_t i = 0; i < aCount; ++i) aValues[i] = (aValues[i] == 0) ? 0.0 : -aValues[i];
+}
+
+template <TCompare KCompare>
+static void CompareScalar(const double* aValues, size_t aCount, double aBound, uint64_t* aMask) {
+    std::fill(aMask, aMask + (aCount + 63) / 64, 0);
+    for (size_t i = 0; i < aCount; ++i) {
+        if (Test<KCompare>(aValues[i], aBound)) aMask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+static uint64_t ContainsScalar(const double* aCandidates, size_t aCount, const double* aValues, size_t aValueCount) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < aCount; ++i) {
+        if (std::find(aValues, aValues + aValueCount, aCandidates[i]) != aValues + aValueCount) mask |= uint64_t(1) << i;
+    }
+    return mask;
+}
+
+static void WithinScalar(const double* aX, const double* aY, const double* aZ, size_t aCount, const double* aCenter, double aRadius, uint64_t* aMask) {
+    std::fill(aMask, aMask + (aCount + 63) / 64, 0);
+    const double limit = aRadius * aRadius;
+    for (size_t i = 0; i < aCount; ++i) {
+        double dx = aX[i] - aCenter[0], dy = aY[i] - aCenter[1], dz = aZ[i] - aCenter[2];
+        if (dx * dx + dy * dy + dz * dz <= limit) aMask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+static const TKernels KScalar = { TIsa::Scalar, NegateScalar,
+    { CompareScalar<TCompare::Less>, CompareScalar<TCompare::LessEqual>, CompareScalar<TCompare::Greater>, CompareScalar<TCompare::GreaterEqual> }, ContainsScalar, WithinScalar };
+
+#ifdef CDOUBLEKERNELS_X86
+static CDOUBLEKERNELS_TARGET("sse2") void NegateSse2(double* aValues, size_t aCount) {
+    const __m128d sign = _mm_set1_pd(-0.0), zero = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= aCount; i += 2) {
+        __m128d value = _mm_loadu_pd(aValues + i);
+        _mm_storeu_pd(aValues + i, _mm_andnot_pd(_mm_cmpeq_pd(value, zero), _mm_xor_pd(value, sign)));
+    }
+    NegateScalar(aValues + i, aCount - i);
+}
+
+template <TCompare KCompare>
+static CDOUBLEKERNELS_TARGET("sse2") void CompareSse2(const double* aValues, size_t aCount, double aBound, uint64_t* aMask) {
+    std::fill(aMask, aMask + (aCount + 63) / 64, 0);
+    const __m128d bound = _mm_set1_pd(aBound);
+    size_t i = 0;
+    for (; i + 2 <= aCount; i += 2) {
+        __m128d value = _mm_loadu_pd(aValues + i), result;
+        if constexpr (KCompare == TCompare::Less) result = _mm_cmplt_pd(value, bound);
+        else if constexpr (KCompare == TCompare::LessEqual) result = _mm_cmple_pd(value, bound);
+        else if constexpr (KCompare == TCompare::Greater) result = _mm_cmpgt_pd(value, bound);
+        else result = _mm_cmpge_pd(value, bound);
+        aMask[i / 64] |= uint64_t(_mm_movemask_pd(result)) << (i % 64);
+    }
+    for (; i < aCount; ++i) {
+        if (Test<KCompare>(aValues[i], aBound)) aMask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+static CDOUBLEKERNELS_TARGET("sse2") uint64_t ContainsSse2(const double* aCandidates, size_t aCount, const double* aValues, size_t aValueCount) {
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 2 <= aCount; i += 2) {
+        const __m128d candidates = _mm_loadu_pd(aCandidates + i);
+        __m128d found = _mm_setzero_pd();
+        for (size_t j = 0; j < aValueCount; ++j) found = _mm_or_pd(found, _mm_cmpeq_pd(candidates, _mm_set1_pd(aValues[j])));
+        mask |= uint64_t(_mm_movemask_pd(found)) << i;
+    }
+    if (i < aCount) mask |= ContainsScalar(aCandidates + i, aCount - i, aValues, aValueCount) << i;
+    return mask;
+}
+
+static CDOUBLEKERNELS_TARGET("sse2") void WithinSse2(const double* aX, const double* aY, const double* aZ, size_t aCount, const double* aCenter, double aRadius, uint64_t* aMask) {
+    std::fill(aMask, aMask + (aCount + 63) / 64, 0);
+    const __m128d cx = _mm_set1_pd(aCenter[0]), cy = _mm_set1_pd(aCenter[1]), cz = _mm_set1_pd(aCenter[2]), limit = _mm_set1_pd(aRadius * aRadius);
+    size_t i = 0;
+    for (; i + 2 <= aCount; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(aX + i), cx), dy = _mm_sub_pd(_mm_loadu_pd(aY + i), cy), dz = _mm_sub_pd(_mm_loadu_pd(aZ + i), cz);
+        __m128d distance = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+        aMask[i / 64] |= uint64_t(_mm_movemask_pd(_mm_cmple_pd(distance, limit))) << (i % 64);
+    }
+    if (i < aCount) {
+        uint64_t tail = 0;
+        WithinScalar(aX + i, aY + i, aZ + i, aCount - i, aCenter, aRadius, &tail);
+        aMask[i / 64] |= tail << (i % 64);
+    }
+}
+
+static CDOUBLEKERNELS_TARGET("avx2") void NegateAvx2(double* aValues, size_t aCount) {
+    const __m256d sign = _mm256_set1_pd(-0.0), zero = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= aCount; i += 4) {
+        __m256d value = _mm256_loadu_pd(aValues + i);
+        _mm256_storeu_pd(aValues + i, _mm256_andnot_pd(_mm256_cmp_pd(value, zero, _CMP_EQ_OQ), _mm256_xor_pd(value, sign)));
+    }
+    NegateScalar(aValues + i, aCount - i);
+}
+
+template <TCompare KCompare>
+static CDOUBLEKERNELS_TARGET("avx2") void CompareAvx2(const double* aValues, size_t aCount, double aBound, uint64_t* aMask) {
+    constexpr int KPredicate = (KCompare == TCompare::Less) ? _CMP_LT_OQ : (KCompare == TCompare::LessEqual) ? _CMP_LE_OQ
+        : (KCompare == TCompare::Greater) ? _CMP_GT_OQ : _CMP_GE_OQ;
+    std::fill(aMask, aMask + (aCount + 63) / 64, 0);
+    const __m256d bound = _mm256_set1_pd(aBound);
+    size_t i = 0;
+    for (; i + 4 <= aCount; i += 4) {
+        aMask[i / 64] |= uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(aValues + i), bound, KPredicate))) << (i % 64);
+    }
+    for (; i < aCount; ++i) {
+        if (Test<KCompare>(aValues[i], aBound)) aMask[i / 64] |= uint64_t(1) << (i % 64);
+    }
+}
+
+static CDOUBLEKERNELS_TARGET("avx2") uint64_t ContainsAvx2(const double* aCandidates, size_t aCount, const double* aValues, size_t aValueCount) {
+    uint64_t mask = 0;
+    size_t i = 0;
+    for (; i + 4 <= aCount; i += 4) {
+        const __m256d candidates = _mm256_loadu_pd(aCandidates + i);
+        __m256d found = _mm256_setzero_pd();
+        for (size_t j = 0; j < aValueCount; ++j) found = _mm256_or_pd(found, _mm256_cmp_pd(candidates, _mm256_set1_pd(aValues[j]), _CMP_EQ_OQ));
+        mask |= uint64_t(_mm256_movemask_pd(found)) << i;
+    }
+    if (i < aCount) mask |= ContainsScalar(aCandidates + i, aCount - i, aValues, aValueCount) << i;
+    return mask;
+}
+
+static CDOUBLEKERNELS_TARGET("avx2") void WithinAvx2(const double* aX, const double* aY, const double* aZ, size_t aCount, const double* aCenter, double aRadius, uint64_t* aMask) {
+    std::fill(aMask, aMask + (aCount + 63) / 64, 0);
+    const __m256d cx = _mm256_set1_pd(aCenter[0]), cy = _mm256_set1_pd(aCenter[1]), cz = _mm256_set1_pd(aCenter[2]), limit = _mm256_set1_pd(aRadius * aRadius);
+    size_t i = 0;
+    for (; i + 4 <= aCount; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(aX + i), cx), dy = _mm256_sub_pd(_mm256_loadu_pd(aY + i), cy), dz = _mm256_sub_pd(_mm256_loadu_pd(aZ + i), cz);
+        __m256d distance = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+        aMask[i / 64] |= uint64_t(_mm256_movemask_pd(_mm256_cmp_pd(distance, limit, _CMP_LE_OQ))) << (i % 64);
+    }
+    if (i < aCount) {
+        uint64_t tail = 0;
+        WithinScalar(aX + i, aY + i, aZ + i, aCount - i, aCenter, aRadius, &tail);
+        aMask[i / 64] |= tail << (i % 64);
+    }
+}
+
+static const TKernels KSse2 = { TIsa::Sse2, NegateSse2,
+    { CompareSse2<TCompare::Less>, CompareSse2<TCompare::LessEqual>, CompareSse2<TCompare::Greater>, CompareSse2<TCompare::GreaterEqual> }, ContainsSse2, WithinSse2 };
+
+static const TKernels KAvx2 = { TIsa::Avx2, NegateAvx2,
+    { CompareAvx2<TCompare::Less>, CompareAvx2<TCompare::LessEqual>, CompareAvx2<TCompare::Greater>, CompareAvx2<TCompare::GreaterEqual> }, ContainsAvx2, WithinAvx2 };
+#endif /* CDOUBLEKERNELS_X86 */
+
+static TIsa Detect() {
+#if defined(CDOUBLEKERNELS_X86) && defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int leaves = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    if (avx && leaves >= 7) {
+        __cpuidex(info, 7, 0);
+        if ((info[1] & (1 << 5)) != 0) return TIsa::Avx2;
+    }
+    if (sse2) return TIsa::Sse2;
+#elif defined(CDOUBLEKERNELS_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return TIsa::Avx2;
+    if (__builtin_cpu_supports("sse2")) return TIsa::Sse2;
+#endif
+    return TIsa::Scalar;
+}
+
+static const TKernels* Table(TIsa aIsa) {
+#ifdef CDOUBLEKERNELS_X86
+    if (aIsa == TIsa::Avx2) return &KAvx2;
+    if (aIsa == TIsa::Sse2) return &KSse2;
+#endif
+    return &KScalar;
+}
+
+static const TKernels*& Selected() {
+    static const TKernels* selected = Table(CDoubleKernels::Supported());
+    return selected;
+}
+
+//Methods
+TIsa CDoubleKernels::Supported() {
+    static const TIsa supported = Detect();
+    return supported;
+}
+
+TIsa CDoubleKernels::Isa() {
+    return Selected()->iIsa;
+}
+
+void CDoubleKernels::Use(TIsa aIsa) {
+    Selected() = Table(std::min(aIsa, Supported()));
+}
+
+void CDoubleKernels::Negate(double* aValues, size_t aCount) {
+    Selected()->iNegate(aValues, aCount);
+}
+
+void CDoubleKernels::Compare(const double* aValues, size_t aCount, TCompare aCompare, double aBound, uint64_t* aMask) {
+    Selected()->iCompare[size_t(aCompare)](aValues, aCount, aBound, aMask);
+}
+
+uint64_t CDoubleKernels::Contains(const double* aCandidates, size_t aCount, const double* aValues, size_t aValueCount) {
+    return Selected()->iContains(aCandidates, aCount, aValues, aValueCount);
+}
+
+void CDoubleKernels::Within(const double* aX, const double* aY, const double* aZ, size_t aCount, const double* aCenter, double aRadius, uint64_t* aMask) {
+    Selected()->iWithin(aX, aY, aZ, aCount, aCenter, aRadius, aMask);
+}
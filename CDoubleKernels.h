@@ -0,0 +1,86 @@
+#ifndef __CDoubleKernels_H__
+#define __CDoubleKernels_H__
+/*
+*  File: CDoubleKernels.h
+*  Brief: CDoubleKernels class header
+*  Details: File contain vectorized loops over arrays of doubles, which are used by CSet of CEntity_CDouble values and by columns of CEntity_TPoint coordinates.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * CDoubleKernels class
+ * Details: Batch membership, threshold comparison, negation and radius test over arrays of doubles.
+ * Every kernel has AVX2, SSE2 and scalar variant, the best variant supported by the processor is selected at the first call.
+ * Comparisons follow operators of CDouble: NaN is never equal, smaller or larger, 0 and -0 are equal.
+ */
+class CDoubleKernels
+	{
+public:
+    /*
+    * Instruction set of kernels
+    */
+    enum class TIsa { Scalar, Sse2, Avx2 };
+
+    /*
+    * Comparison of values with the bound
+    */
+    enum class TCompare { Less, LessEqual, Greater, GreaterEqual };
+
+    /*
+    * Method: Supported instruction set
+    * Return: the best instruction set supported by the processor
+    */
+    static TIsa Supported();
+
+    /*
+    * Method: Selected instruction set
+    * Return: instruction set used by kernels
+    */
+    static TIsa Isa();
+
+    /*
+    * Method: Select instruction set
+    * Details: selects kernels of given instruction set (or the best supported one, when given set is not supported), for comparing the variants,
+    * it must not be called while kernels run in other threads
+    * Parameters: aIsa is requested instruction set
+    */
+    static void Use(TIsa aIsa);
+
+    /*
+    * Method: Negate
+    * Details: negates all values like CDouble::operator-(), so 0 and -0 give 0
+    * Parameters: aValues is array of values, aCount is number of values
+    */
+    static void Negate(double* aValues, size_t aCount);
+
+    /*
+    * Method: Compare with bound
+    * Details: sets bit i % 64 of aMask[i / 64] when aValues[i] is in given relation with aBound, the other bits are cleared
+    * Parameters: aValues is array of values, aCount is number of values, aCompare is the relation, aBound is compared bound,
+    * aMask is array of (aCount + 63) / 64 words
+    */
+    static void Compare(const double* aValues, size_t aCount, TCompare aCompare, double aBound, uint64_t* aMask);
+
+    /*
+    * Method: Contains
+    * Details: compares every candidate with all values, intended for small sets, where it is faster than hash probes
+    * Parameters: aCandidates is array of at most 64 searched values, aCount is number of candidates, aValues is array of values, aValueCount is number of values
+    * Return: bitmask, bit i is set when aCandidates[i] is equal to some of values
+    */
+    static uint64_t Contains(const double* aCandidates, size_t aCount, const double* aValues, size_t aValueCount);
+
+    /*
+    * Method: Within radius
+    * Details: sets bit i % 64 of aMask[i / 64] when point [aX[i], aY[i], aZ[i]] is within aRadius from aCenter, the other bits are cleared,
+    * squared distances are computed as (x - cx) * (x - cx) + (y - cy) * (y - cy) + (z - cz) * (z - cz) and compared with aRadius * aRadius
+    * in all variants (without fused multiply-add), so every variant gives the same result as TPoint::IsWithin()
+    * Parameters: aX, aY and aZ are arrays of coordinates, aCount is number of points, aCenter is array of 3 center coordinates, aRadius is the radius,
+    * aMask is array of (aCount + 63) / 64 words
+    */
+    static void Within(const double* aX, const double* aY, const double* aZ, size_t aCount, const double* aCenter, double aRadius, uint64_t* aMask);
+	}; /* class CDoubleKernels */
+
+#endif /* __CDoubleKernels_H__ */
@@ -10,6 +10,11 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <functional>	// Due to: std::hash<double>
+#include <compare>		// Due to: std::weak_order
+#include <algorithm>		// Due to: std::min
+#include <charconv>		// Due to: std::from_chars, std::to_chars
+#include <cmath>		// Due to: std::fabs
 #include <stdexcept>
 #include <typeinfo>
 #include <utility>		// Due to: std::declval<CEntityBase>
@@ -31,6 +36,10 @@ namespace CEntity_CDouble
 	class CDouble {
 		double iVal; ///< Encapsulated  double value.
 	public:
+		static constexpr size_t KCharsMax = 32; ///< Maximal length of value formatted by ToChars()
+		static constexpr int KPrecisionMax = 17; ///< Number of significant digits, which always round-trips (larger precision of ToChars() is clamped to it)
+		static constexpr unsigned short KTypeTag = 1; ///< Tag of CDouble values in binary set files
+		static constexpr size_t KAxes = 1; ///< Number of coordinates (see Coordinate())
 		
 		/*
 		* Method: Implicit c'tor
@@ -48,17 +57,14 @@ namespace CEntity_CDouble
 		* Details: Create new instance by copying only \p iVal parameter.
 		* Parameters:	aVal	Original instance for copying
 		*/
-		CDouble(const CDouble& aVal) :iVal(aVal.iVal) {}
+		CDouble(const CDouble& aVal) = default;
 		
 		/*
 		* Method: Assigment operator
+		* Details: Copies only \p iVal parameter, defaulted so CDouble stays trivially copyable (packed binary storage).
 		* Return: CDouble instance iVal
 		*/
-		CDouble& operator=(const CDouble& aVal)
-		{
-			iVal = aVal.iVal;
-			return *this;
-		}
+		CDouble& operator=(const CDouble& aVal) = default;
 		/*
 		* Method: Inverse operator
 		* Return: CDouble instance with inversed iVal value
@@ -85,6 +91,43 @@ namespace CEntity_CDouble
 			return iVal <=> aValue.iVal;
 		}
 		/*
+		* Method: Coordinate getter
+		* Details: Values lie on the first axis of the space (for spatial indexes shared with TPoint values).
+		* Parameters:	aAxis	Index of axis
+		* Return: Return  iVal for axis 0, otherwise 0
+		*/
+		double Coordinate(size_t aAxis) const
+		{
+			return (aAxis == 0) ? iVal : 0.0;
+		}
+		/*
+		* Method: Within radius
+		* Return: Return  true when distance of iVal from the center is at most aRadius
+		*/
+		bool IsWithin(const CDouble& aCenter, double aRadius) const
+		{
+			return std::fabs(iVal - aCenter.iVal) <= aRadius;
+		}
+		/*
+		* Method: Total order
+		* Details: Same order as operator<=>, but 0 and -0 are equivalent and NaN values are ordered too (IEEE total order by std::weak_order:
+		* NaN with negative sign is smaller than every number, NaN with positive sign is larger than every number), so the values can be sorted.
+		* Return: Return  std::weak_ordering result of comparation
+		*/
+		std::weak_ordering Order(const CDouble& aValue) const
+		{
+			return std::weak_order(iVal, aValue.iVal);
+		}
+		/*
+		* Method: Hash value
+		* Details: Hash is consistent with operator==, so 0 and -0 have the same hash.
+		* Return: Return  size_t hash of iVal value
+		*/
+		size_t Hash() const
+		{
+			return std::hash<double>{}(iVal == 0 ? 0.0 : iVal);
+		}
+		/*
 		* Method: Output to the stream operator. (\em serialization)
 		* Parameters:	aOStream	Output stream
 		* Parameters:	aValue		Serialized instantions of CDouble
@@ -109,6 +152,34 @@ namespace CEntity_CDouble
 
 			return aIStream;
 		}
+		/*
+		* Method: Parsing from character buffer
+		* Details: Leading white spaces and '+' sign are skipped, number is parsed by std::from_chars.
+		* Parameters:	aFirst	Beginning of the buffer
+		* Parameters:	aLast	End of the buffer
+		* Parameters:	aValue	Place for parsed value
+		* Return: Return pointer behind the parsed number, nullptr when there is no valid number
+		*/
+		static const char* FromChars(const char* aFirst, const char* aLast, CDouble& aValue)
+		{
+			while (aFirst != aLast && (*aFirst == ' ' || *aFirst == '\t' || *aFirst == '\n' || *aFirst == '\r')) ++aFirst;
+			if (aFirst != aLast && *aFirst == '+') ++aFirst;
+			std::from_chars_result result = std::from_chars(aFirst, aLast, aValue.iVal);
+			return (result.ec == std::errc()) ? result.ptr : nullptr;
+		}
+		/*
+		* Method: Formatting into character buffer
+		* Details: Number is formatted by std::to_chars, with precision 6 the text is the same as the one of the output operator with default stream flags.
+		* Parameters:	aFirst	Beginning of the buffer (at least KCharsMax characters)
+		* Parameters:	aLast	End of the buffer
+		* Parameters:	aPrecision	Number of significant digits (at most KPrecisionMax is used), negative value selects the shortest text which is parsed back to the same value
+		* Return: Return pointer behind the formatted number, nullptr when the buffer is too small
+		*/
+		char* ToChars(char* aFirst, char* aLast, int aPrecision = 6) const
+		{
+			std::to_chars_result result = (aPrecision < 0) ? std::to_chars(aFirst, aLast, iVal) : std::to_chars(aFirst, aLast, iVal, std::chars_format::general, std::min(aPrecision, KPrecisionMax));
+			return (result.ec == std::errc()) ? result.ptr : nullptr;
+		}
 	};
 
 
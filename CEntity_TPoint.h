@@ -12,6 +12,10 @@
 #include <sstream>
 #include <cmath>
 #include <string>
+#include <functional>	// Due to: std::hash<double>
+#include <compare>		// Due to: std::weak_order
+#include <algorithm>		// Due to: std::min
+#include <charconv>		// Due to: std::from_chars, std::to_chars
 #include <stdexcept>
 #include <typeinfo>
 #include <utility>		// Due to: std::declval<CEntityBase>
@@ -30,18 +34,34 @@ namespace CEntity_TPoint
 {
 	/*
 	* Basic definition of class TPoint which are representing point coordinates in space.
+	* Distance from the origin is computed once, when coordinates are set, and ordering comparisons use the cached value.
 	*/
 	class TPoint
 	{
 		double iX; ///< Representing X coordinate of point.
 		double iY; ///< Representing Y coordinate of point.
 		double iZ; ///< Representing Z coordinate of point.
+		double iNorm; ///< Cached distance of point from the origin.
+
+		/*
+		* Method: Distance from the origin
+		* Details: computed always by the same expression, so cached values compare exactly as values computed at every comparison
+		* Return: Return  distance of point [aX, aY, aZ] from the origin
+		*/
+		static double Distance(double aX, double aY, double aZ)
+		{
+			return sqrt(pow(aX, 2) + pow(aY, 2) + pow(aZ, 2));
+		}
 	public:
+		static constexpr size_t KCharsMax = 3 * 32 + 2; ///< Maximal length of value formatted by ToChars()
+		static constexpr int KPrecisionMax = 17; ///< Number of significant digits, which always round-trips (larger precision of ToChars() is clamped to it)
+		static constexpr unsigned short KTypeTag = 2; ///< Tag of TPoint values in binary set files
+		static constexpr size_t KAxes = 3; ///< Number of coordinates (see Coordinate())
 		/*
 		* Method: Implicit c'tor
 		* Details: attributes are set:  iX = 0, iY = 0, iZ = 0.
 		*/
-		TPoint() :iX(0), iY(0), iZ(0) {}
+		TPoint() :iX(0), iY(0), iZ(0), iNorm(0) {}
 		/*
 		* Method: Conversion c'tor
 		* Details: values of iX, iY, iZ are set.
@@ -49,31 +69,73 @@ namespace CEntity_TPoint
 		* Parameters:	aY	New encapsulated  TPoint iY Value
 		* Parameters:	aZ	New encapsulated  TPoint iZ Value
 		*/
-		TPoint(double aX, double aY, double aZ) :iX(aX), iY(aY), iZ(aZ) {}
+		TPoint(double aX, double aY, double aZ) :iX(aX), iY(aY), iZ(aZ), iNorm(Distance(aX, aY, aZ)) {}
 		/*
 		* Method: Copy c'tor
-		* Details: Create new instance by copying \p iX, iY, iZ parameter.
+		* Details: Create new instance by copying \p iX, iY, iZ parameter and cached distance.
 		*  Parameters:	aPoint	Original instance for copying
 		*/
-		TPoint(const TPoint& aPoint) :iX(aPoint.iX), iY(aPoint.iY), iZ(aPoint.iZ) {}
+		TPoint(const TPoint& aPoint) = default;
 		/*
 		* Method: Assigment operator
+		* Details: Copies iX, iY, iZ values and cached distance, defaulted so TPoint stays trivially copyable (packed binary storage).
 		* Return: TPoint instance with copied iX, iY, iZ values.
 		*/
-		TPoint& operator=(const TPoint& aVal)
-		{
-			iX = aVal.iX;
-			iY = aVal.iY;
-			iZ = aVal.iZ;
-			return *this;
-		}
+		TPoint& operator=(const TPoint& aVal) = default;
 		/*
 		* Method: Inverse operator
 		* Return: TPoint instance with inversed iX, iY, iZ values.
 		*/
 		TPoint operator-() const
 		{
-			return TPoint(-iX, -iY, -iZ);
+			TPoint result(*this);
+			result.iX = -iX;
+			result.iY = -iY;
+			result.iZ = -iZ;
+			return result;
+		}
+		/*
+		* Method: Distance getter
+		* Return: Return  cached distance of point from the origin
+		*/
+		double Norm() const
+		{
+			return iNorm;
+		}
+		/*
+		* Method: Coordinate getters
+		* Return: Return  iX, iY or iZ value
+		*/
+		double X() const
+		{
+			return iX;
+		}
+		double Y() const
+		{
+			return iY;
+		}
+		double Z() const
+		{
+			return iZ;
+		}
+		/*
+		* Method: Coordinate getter
+		* Parameters:	aAxis	Index of axis (0 for X, 1 for Y, 2 for Z)
+		* Return: Return  coordinate on given axis
+		*/
+		double Coordinate(size_t aAxis) const
+		{
+			return (aAxis == 0) ? iX : (aAxis == 1) ? iY : iZ;
+		}
+		/*
+		* Method: Within radius
+		* Details: Squared distance from the center is compared with squared radius (the same expression is used by vectorized kernels).
+		* Return: Return  true when the point is within aRadius from aCenter
+		*/
+		bool IsWithin(const TPoint& aCenter, double aRadius) const
+		{
+			double dx = iX - aCenter.iX, dy = iY - aCenter.iY, dz = iZ - aCenter.iZ;
+			return dx * dx + dy * dy + dz * dz <= aRadius * aRadius;
 		}
 		/*
 		* Method: Comparing by Value operator
@@ -85,15 +147,38 @@ namespace CEntity_TPoint
 		}
 		/*
 		* Method: Threeway comparison by Value operator
-		* Details: Comparison based on the distance of points from the origin
+		* Details: Comparison based on the (cached) distance of points from the origin
 		* Return: Return  std::partial_ordering result of comparation
 		*/
 		std::partial_ordering operator<=>(const TPoint& aValue) const
 		{
-
-			double iDistance = sqrt(pow(iX, 2) + pow(iY, 2) + pow(iZ, 2));
-			double aDistance = sqrt(pow(aValue.iX, 2) + pow(aValue.iY, 2) + pow(aValue.iZ, 2));
-			return iDistance <=> aDistance;
+			return iNorm <=> aValue.iNorm;
+		}
+		/*
+		* Method: Total order
+		* Details: Points are ordered by the distance from the origin (same as operator<=>), points with the same distance by iX, iY and iZ values.
+		* Equivalent points are equal, so the values can be sorted and merged.
+		* Return: Return  std::weak_ordering result of comparation
+		*/
+		std::weak_ordering Order(const TPoint& aValue) const
+		{
+			if (std::weak_ordering order = std::weak_order(iNorm, aValue.iNorm); order != 0) return order;
+			if (std::weak_ordering order = std::weak_order(iX, aValue.iX); order != 0) return order;
+			if (std::weak_ordering order = std::weak_order(iY, aValue.iY); order != 0) return order;
+			return std::weak_order(iZ, aValue.iZ);
+		}
+		/*
+		* Method: Hash value
+		* Details: Combined hash of iX, iY, iZ values, consistent with operator== (0 and -0 have the same hash).
+		* Return: Return  size_t hash of the point
+		*/
+		size_t Hash() const
+		{
+			std::hash<double> hasher;
+			size_t hash = hasher(iX == 0 ? 0.0 : iX);
+			hash ^= hasher(iY == 0 ? 0.0 : iY) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+			hash ^= hasher(iZ == 0 ? 0.0 : iZ) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+			return hash;
 		}
 
 		/*
@@ -119,9 +204,56 @@ namespace CEntity_TPoint
 		{
 
 			aIStream >> aValue.iX >> aValue.iY >> aValue.iZ;
+			aValue.iNorm = Distance(aValue.iX, aValue.iY, aValue.iZ);
 
 			return aIStream;
 		}
+		/*
+		* Method: Parsing from character buffer
+		* Details: Three coordinates are separated by white spaces or ';', every coordinate is parsed by std::from_chars.
+		* Parameters:	aFirst	Beginning of the buffer
+		* Parameters:	aLast	End of the buffer
+		* Parameters:	aValue	Place for parsed value
+		* Return: Return pointer behind the last parsed coordinate, nullptr when there are not three valid coordinates
+		*/
+		static const char* FromChars(const char* aFirst, const char* aLast, TPoint& aValue)
+		{
+			double* coords[] = { &aValue.iX, &aValue.iY, &aValue.iZ };
+			for (double* coord : coords)
+			{
+				while (aFirst != aLast && (*aFirst == ' ' || *aFirst == ';' || *aFirst == '\t' || *aFirst == '\n' || *aFirst == '\r')) ++aFirst;
+				if (aFirst != aLast && *aFirst == '+') ++aFirst;
+				std::from_chars_result result = std::from_chars(aFirst, aLast, *coord);
+				if (result.ec != std::errc()) return nullptr;
+				aFirst = result.ptr;
+			}
+			aValue.iNorm = Distance(aValue.iX, aValue.iY, aValue.iZ);
+			return aFirst;
+		}
+		/*
+		* Method: Formatting into character buffer
+		* Details: Coordinates are formatted by std::to_chars and separated by space, with precision 6 the text is the same as the one of the output operator with default stream flags.
+		* Parameters:	aFirst	Beginning of the buffer (at least KCharsMax characters)
+		* Parameters:	aLast	End of the buffer
+		* Parameters:	aPrecision	Number of significant digits (at most KPrecisionMax is used), negative value selects the shortest text which is parsed back to the same value
+		* Return: Return pointer behind the formatted point, nullptr when the buffer is too small
+		*/
+		char* ToChars(char* aFirst, char* aLast, int aPrecision = 6) const
+		{
+			const double coords[] = { iX, iY, iZ };
+			for (size_t i = 0; i < 3; ++i)
+			{
+				if (i > 0)
+				{
+					if (aFirst == aLast) return nullptr;
+					*aFirst++ = ' ';
+				}
+				std::to_chars_result result = (aPrecision < 0) ? std::to_chars(aFirst, aLast, coords[i]) : std::to_chars(aFirst, aLast, coords[i], std::chars_format::general, std::min(aPrecision, KPrecisionMax));
+				if (result.ec != std::errc()) return nullptr;
+				aFirst = result.ptr;
+			}
+			return aFirst;
+		}
 	};
 	class CEntity : public CEntityBase
 	{
@@ -0,0 +1,538 @@
+#ifndef __CFlatStorage_H__
+#define __CFlatStorage_H__
+/*
+*  File: CFlatStorage.h
+*  Brief: CFlatStorage class header
+*  Details: File contain contiguous storage of set values, which is used by CSet instead of linear list of CEntity nodes.
+*  Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "CSetIndex.h"
+
+/*
+ * CFlatStorage class
+ * Details: Values (CDouble or TPoint) are stored in one array in insertion order, hash index maps every value to its slot.
+ * Erased values leave dead slots behind, so erasing keeps the order in O(1); array is compacted once dead slots prevail.
+ * Small storage keeps up to KInline values inside of the object (dense, found by linear scan) and does not allocate any memory,
+ * values are spilled into heap array with hash index when the next value does not fit, Clear() returns the storage into the small mode.
+ * Inline values and pointer to the heap array share memory of the object (union), only one of them is alive (see iSpilled);
+ * inline buffer is not initialized, only its first iSize values are constructed.
+ * Heap array is reference counted and shared by copies of the storage (copy is O(1)), every modifying method makes private copy
+ * of the array first, when it is shared (copy-on-write), so shared array is never modified.
+ */
+template <typename TValue>
+class CFlatStorage {
+public:
+    static constexpr size_t KInline = 8; ///< Maximal number of values kept inside of the object
+
+private:
+    /*
+    * Heap array of spilled values
+    */
+    struct THeap {
+        std::vector<TValue> iValues; ///< Slots with values in insertion order
+        std::vector<bool> iLive; ///< Slot holds value (false for erased values)
+        CSetIndex<TValue, size_t> iIndex; ///< Hash index of values, every value is mapped to its slot
+
+        /*
+        * Method: Reindex
+        * Details: rebuilds hash index from slots
+        */
+        void Reindex() {
+            iIndex.Build(iValues.data(), iValues.size(), [&](size_t aSlot) { return bool(iLive[aSlot]); });
+        }
+    };
+
+    union {
+        alignas(TValue) unsigned char iInline[KInline * sizeof(TValue)]; ///< Buffer of small storage, values are kept in insertion order (without dead slots)
+        std::shared_ptr<THeap> iHeap; ///< Heap array shared by copies of the storage, alive only when iSpilled is set
+    };
+    bool iSpilled = false; ///< Values were spilled into the heap array (iHeap is alive), otherwise they are kept in iInline
+    size_t iSize = 0; ///< Number of live values
+
+    /*
+    * Method: Inline values
+    * Return: values of small storage, only the first iSize values are constructed
+    */
+    TValue* Inline() { return std::launder(reinterpret_cast<TValue*>(iInline)); }
+    const TValue* Inline() const { return std::launder(reinterpret_cast<const TValue*>(iInline)); }
+
+    /*
+    * Method: Reset
+    * Details: destroys inline values or releases the heap array, the storage is small and empty then
+    */
+    void Reset() {
+        if (iSpilled) std::destroy_at(&iHeap);
+        else std::destroy_n(Inline(), iSize);
+        iSpilled = false;
+        iSize = 0;
+    }
+
+    /*
+    * Method: Take
+    * Details: shares heap array or copies inline values of another storage, this storage has to be empty (see Reset)
+    * Parameters: aVal is copied storage
+    */
+    void Take(const CFlatStorage& aVal) {
+        if (aVal.iSpilled) std::construct_at(&iHeap, aVal.iHeap);
+        else std::uninitialized_copy_n(aVal.Inline(), aVal.iSize, Inline());
+        iSpilled = aVal.iSpilled;
+        iSize = aVal.iSize;
+    }
+
+    /*
+    * Method: Take over
+    * Details: takes over heap array or copies inline values of another storage, which is left empty, this storage has to be empty (see Reset)
+    * Parameters: aVal is moved storage
+    */
+    void Take(CFlatStorage&& aVal) noexcept {
+        if (aVal.iSpilled) std::construct_at(&iHeap, std::move(aVal.iHeap));
+        else std::uninitialized_copy_n(aVal.Inline(), aVal.iSize, Inline());
+        iSpilled = aVal.iSpilled;
+        iSize = aVal.iSize;
+        aVal.Reset();
+    }
+
+    /*
+    * Method: Own
+    * Details: makes private copy of the heap array, when it is shared with another storage, has to be called by every modification of the array
+    * Return: heap array, which can be modified
+    */
+    THeap& Own() {
+        if (iHeap.use_count() > 1) iHeap = std::make_shared<THeap>(*iHeap);
+        return *iHeap;
+    }
+
+    /*
+    * Method: Spill
+    * Details: moves inline values into new heap array and builds hash index
+    * Parameters: aCount is expected number of values
+    */
+    void Spill(size_t aCount) {
+        if (iSpilled) return;
+        std::shared_ptr<THeap> heap = std::make_shared<THeap>();
+        heap->iValues.reserve(std::max(aCount, iSize));
+        heap->iLive.reserve(std::max(aCount, iSize));
+        heap->iValues.assign(Inline(), Inline() + iSize);
+        heap->iLive.assign(iSize, true);
+        heap->Reindex();
+        std::destroy_n(Inline(), iSize);
+        std::construct_at(&iHeap, std::move(heap));
+        iSpilled = true;
+    }
+
+    /*
+    * Method: Find inline
+    * Return: position of the value among inline values, iSize when it is not stored
+    */
+    size_t FindInline(const TValue& aValue) const {
+        size_t i = 0;
+        const TValue* values = Inline();
+        while (i < iSize && !(values[i] == aValue)) ++i;
+        return i;
+    }
+
+public:
+    /*
+     * const_iterator class
+     * Details: Forward iterator over stored values in insertion order, dead slots are skipped.
+     */
+    class const_iterator {
+        const CFlatStorage* iStorage = nullptr; ///< Iterated storage
+        size_t iPos = 0; ///< Actual slot
+
+        /*
+        * Method: Skip
+        * Details: moves iterator to the nearest live slot
+        */
+        void Skip() {
+            while (iPos < iStorage->SlotCount() && !iStorage->Live(iPos)) ++iPos;
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TValue;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TValue*;
+        using reference = const TValue&;
+
+        const_iterator() = default;
+
+        /*
+        * Method: Conversion c'tor
+        * Parameters: aStorage is iterated storage, aPos is starting slot
+        */
+        const_iterator(const CFlatStorage* aStorage, size_t aPos) : iStorage(aStorage), iPos(aPos) { Skip(); }
+
+        reference operator*() const { return iStorage->At(iPos); }
+        pointer operator->() const { return &iStorage->At(iPos); }
+
+        const_iterator& operator++() {
+            ++iPos;
+            Skip();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator temp = *this;
+            ++*this;
+            return temp;
+        }
+
+        bool operator==(const const_iterator& aVal) const { return iPos == aVal.iPos; }
+    }; /* class const_iterator */
+
+    /*
+    * Method: Implicit c'tor
+    * Details: storage is small and empty
+    */
+    CFlatStorage() {}
+
+    /*
+    * Method: Copy c'tor
+    * Details: shares heap array of the original (see Own), inline values are copied
+    * Parameters: aVal is copied storage
+    */
+    CFlatStorage(const CFlatStorage& aVal) { Take(aVal); }
+
+    /*
+    * Method: Assignment operator
+    * Details: shares heap array of the original (see Own), inline values are copied
+    * Parameters: aVal is copied storage
+    */
+    CFlatStorage& operator=(const CFlatStorage& aVal) {
+        if (this == &aVal) return *this;
+        Reset();
+        Take(aVal);
+        return *this;
+    }
+
+    /*
+    * Method: Move c'tor
+    * Details: takes over all values, original storage is left empty
+    * Parameters: aVal is moved storage
+    */
+    CFlatStorage(CFlatStorage&& aVal) noexcept { Take(std::move(aVal)); }
+
+    /*
+    * Method: Move assignment operator
+    * Details: takes over all values, original storage is left empty
+    * Parameters: aVal is moved storage
+    */
+    CFlatStorage& operator=(CFlatStorage&& aVal) noexcept {
+        if (this == &aVal) return *this;
+        Reset();
+        Take(std::move(aVal));
+        return *this;
+    }
+
+    /*
+    * Method: D'tor
+    * Details: destroys inline values or releases the heap array
+    */
+    ~CFlatStorage() { Reset(); }
+
+    /*
+    * Method: Size
+    * Return: number of stored values
+    */
+    size_t Size() const { return iSize; }
+
+    /*
+    * Method: Dense
+    * Return: true when there are no dead slots, so all slots can be read as one array
+    */
+    bool Dense() const { return iSize == SlotCount(); }
+
+    /*
+    * Method: Shared
+    * Return: true when the heap array is shared with another storage
+    */
+    bool Shared() const { return iSpilled && iHeap.use_count() > 1; }
+
+    /*
+    * Method: Reserve
+    * Details: spills small storage, when aCount values do not fit inside of the object
+    * Parameters: aCount is expected number of values
+    */
+    void Reserve(size_t aCount) {
+        if (!iSpilled) {
+            if (aCount <= KInline) return;
+            Spill(aCount);
+        }
+        THeap& heap = Own();
+        heap.iValues.reserve(aCount);
+        heap.iLive.reserve(aCount);
+        heap.iIndex.Reserve(aCount);
+    }
+
+    /*
+    * Method: Contains
+    * Parameters: aValue is searched value
+    * Return: true when the value is stored
+    */
+    bool Contains(const TValue& aValue) const {
+        if (!iSpilled) return FindInline(aValue) < iSize;
+        return iHeap->iIndex.Find(aValue) != nullptr;
+    }
+
+    /*
+    * Method: Insert
+    * Details: appends value, which is not stored yet
+    * Parameters: aValue is inserted value
+    * Return: true if the value was appended, false if it was already stored
+    */
+    bool Insert(const TValue& aValue) {
+        if (!iSpilled) {
+            if (FindInline(aValue) < iSize) return false;
+            if (iSize < KInline) {
+                std::construct_at(Inline() + iSize, aValue);
+                ++iSize;
+                return true;
+            }
+            Spill(2 * KInline);
+        }
+        if (Shared() && Contains(aValue)) return false; // no copy of the array for value, which is already stored
+        THeap& heap = Own();
+        if (!heap.iIndex.Insert(aValue, heap.iValues.size())) return false;
+        heap.iValues.push_back(aValue);
+        heap.iLive.push_back(true);
+        ++iSize;
+        return true;
+    }
+
+    /*
+    * Method: Append
+    * Details: appends values, which are distinct and not stored yet, and rebuilds the index at once (in parallel for large storages)
+    * Parameters: aValues is array of appended values, aCount is number of values
+    */
+    void Append(const TValue* aValues, size_t aCount) {
+        if (aCount == 0) return;
+        if (!iSpilled && iSize + aCount <= KInline) {
+            std::uninitialized_copy_n(aValues, aCount, Inline() + iSize);
+            iSize += aCount;
+            return;
+        }
+        Spill(iSize + aCount);
+        THeap& heap = Own();
+        heap.iValues.insert(heap.iValues.end(), aValues, aValues + aCount);
+        heap.iLive.resize(heap.iValues.size(), true);
+        iSize += aCount;
+        heap.Reindex();
+    }
+
+    /*
+    * Method: Erase
+    * Details: marks slot of the value as dead, compacts the array when more than half of the slots are dead
+    * (small storage shifts following values, so it stays dense)
+    * Parameters: aValue is erased value
+    * Return: true if the value was erased, false if it was not stored
+    */
+    bool Erase(const TValue& aValue) {
+        if (!iSpilled) {
+            size_t i = FindInline(aValue);
+            if (i == iSize) return false;
+            TValue* values = Inline();
+            std::copy(values + i + 1, values + iSize, values + i);
+            std::destroy_at(values + --iSize);
+            return true;
+        }
+        if (Shared() && !Contains(aValue)) return false; // no copy of the array for value, which is not stored
+        THeap& heap = Own();
+        const size_t* slot = heap.iIndex.Find(aValue);
+        if (slot == nullptr) return false;
+        heap.iLive[*slot] = false;
+        heap.iIndex.Erase(aValue);
+        --iSize;
+        while (!heap.iLive.empty() && !heap.iLive.back()) {
+            heap.iValues.pop_back();
+            heap.iLive.pop_back();
+        }
+        if (iSize * 2 < heap.iValues.size()) Compact();
+        return true;
+    }
+
+    /*
+    * Method: Remove if
+    * Details: erases all values, for which the predicate holds, order of remaining values is kept
+    * Parameters: aPred is callable with const TValue& parameter returning bool
+    * Return: number of erased values
+    */
+    template <typename TPred>
+    size_t RemoveIf(TPred aPred) {
+        if (!iSpilled) {
+            TValue* values = Inline();
+            size_t removed = iSize;
+            iSize = size_t(std::remove_if(values, values + removed, aPred) - values);
+            std::destroy(values + iSize, values + removed);
+            return removed - iSize;
+        }
+        THeap& heap = Own();
+        size_t j = 0;
+        for (size_t i = 0; i < heap.iValues.size(); ++i) {
+            if (heap.iLive[i] && !aPred(heap.iValues[i])) heap.iValues[j++] = heap.iValues[i];
+        }
+        size_t removed = iSize - j;
+        heap.iValues.resize(j);
+        heap.iLive.assign(j, true);
+        iSize = j;
+        heap.Reindex();
+        return removed;
+    }
+
+    /*
+    * Method: Compact
+    * Details: moves live values to the beginning of the array and drops dead slots
+    */
+    void Compact() {
+        if (Dense()) return;
+        THeap& heap = Own();
+        size_t j = 0;
+        for (size_t i = 0; i < heap.iValues.size(); ++i) {
+            if (heap.iLive[i]) heap.iValues[j++] = heap.iValues[i];
+        }
+        heap.iValues.resize(j);
+        heap.iLive.assign(j, true);
+        heap.Reindex();
+    }
+
+    /*
+    * Method: Clear
+    * Details: removes all values and releases the memory (unless it is shared), the storage is small again
+    */
+    void Clear() { Reset(); }
+
+    /*
+    * Method: Reverse
+    * Details: reverses order of stored values
+    */
+    void Reverse() {
+        if (!iSpilled) {
+            std::reverse(Inline(), Inline() + iSize);
+            return;
+        }
+        Compact();
+        THeap& heap = Own();
+        std::reverse(heap.iValues.begin(), heap.iValues.end());
+        heap.Reindex();
+    }
+
+    /*
+    * Method: Transform
+    * Details: applies given function to every stored value, the function has to keep values unique
+    * Parameters: aFunc is callable with TValue& parameter
+    */
+    template <typename TFunc>
+    void Transform(TFunc aFunc) {
+        if (!iSpilled) {
+            std::for_each(Inline(), Inline() + iSize, aFunc);
+            return;
+        }
+        THeap& heap = Own();
+        for (size_t i = 0; i < heap.iValues.size(); ++i) {
+            if (heap.iLive[i]) aFunc(heap.iValues[i]);
+        }
+        heap.Reindex();
+    }
+
+    /*
+    * Method: Transform slots
+    * Details: applies given function to the whole array of slots at once (dead slots included), the function has to keep live values unique
+    * Parameters: aFunc is callable with TValue* and size_t (number of slots) parameters
+    */
+    template <typename TFunc>
+    void TransformSlots(TFunc aFunc) {
+        if (!iSpilled) {
+            aFunc(Inline(), iSize);
+            return;
+        }
+        THeap& heap = Own();
+        aFunc(heap.iValues.data(), heap.iValues.size());
+        heap.Reindex();
+    }
+
+    /*
+    * Method: Begin
+    * Return: iterator on the first stored value
+    */
+    const_iterator begin() const { return const_iterator(this, 0); }
+
+    /*
+    * Method: End
+    * Return: iterator behind the last stored value
+    */
+    const_iterator end() const { return const_iterator(this, SlotCount()); }
+
+    /*
+    * Method: Slot count
+    * Return: number of slots (live and dead ones)
+    */
+    size_t SlotCount() const { return iSpilled ? iHeap->iValues.size() : iSize; }
+
+    /*
+    * Method: Data
+    * Return: array of SlotCount() slots, values in dead slots have to be skipped (see ForEachSlot) unless the storage is Dense()
+    */
+    const TValue* Data() const { return iSpilled ? iHeap->iValues.data() : Inline(); }
+
+    /*
+    * Method: Slot of value
+    * Parameters: aValue is searched value
+    * Return: slot of the value, SlotCount() when the value is not stored
+    */
+    size_t Slot(const TValue& aValue) const {
+        if (!iSpilled) return FindInline(aValue);
+        const size_t* slot = iHeap->iIndex.Find(aValue);
+        return slot ? *slot : iHeap->iValues.size();
+    }
+
+    /*
+    * Method: Live slot
+    * Parameters: aSlot is slot lower than SlotCount()
+    * Return: true when the slot holds value
+    */
+    bool Live(size_t aSlot) const { return !iSpilled || iHeap->iLive[aSlot]; }
+
+    /*
+    * Method: Value in slot
+    * Parameters: aSlot is slot of live value (as given by ForEachSlot)
+    * Return: value stored in the slot
+    */
+    const TValue& At(size_t aSlot) const { return Data()[aSlot]; }
+
+    /*
+    * Method: For each slot
+    * Details: calls given function for every stored value in insertion order together with its slot, slots are valid until the next modification
+    * Parameters: aFunc is callable with size_t and const TValue& parameters
+    */
+    template <typename TFunc>
+    void ForEachSlot(TFunc aFunc) const {
+        const TValue* data = Data();
+        for (size_t i = 0; i < SlotCount(); ++i) {
+            if (Live(i)) aFunc(i, data[i]);
+        }
+    }
+
+    /*
+    * Method: For each
+    * Details: calls given function for every stored value in insertion order
+    * Parameters: aFunc is callable with const TValue& parameter
+    */
+    template <typename TFunc>
+    void ForEach(TFunc aFunc) const {
+        const TValue* data = Data();
+        for (size_t i = 0; i < SlotCount(); ++i) {
+            if (Live(i)) aFunc(data[i]);
+        }
+    }
+}; /* class CFlatStorage */
+
+#endif /* __CFlatStorage_H__ */
@@ -0,0 +1,108 @@
+#ifndef __CNodeArena_H__
+#define __CNodeArena_H__
+/*
+*  File: CNodeArena.h
+*  Brief: CNodeArena class header
+*  Details: File contain slab allocator for CEntity nodes of linear list materialized by CSet.
+*  Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+/*
+ * CNodeArena class
+ * Details: Nodes are constructed in contiguous slabs, every slab is allocated by one call of the allocator.
+ * Nodes can not be deleted one by one, Release() destroys all nodes and frees all slabs at once.
+ */
+template <typename TNode>
+class CNodeArena {
+
+    /*
+    * Slab of nodes
+    */
+    struct TSlab {
+        TNode* iNodes; ///< Storage for iCapacity nodes
+        size_t iCapacity; ///< Number of nodes, which fit into the slab
+        size_t iUsed; ///< Number of constructed nodes
+    };
+
+    std::vector<TSlab> iSlabs; ///< Allocated slabs, the last one is filled
+    std::allocator<TNode> iAllocator; ///< Allocator of slab memory
+
+public:
+    CNodeArena() = default;
+    CNodeArena(const CNodeArena&) = delete;
+    CNodeArena& operator=(const CNodeArena&) = delete;
+
+    /*
+    * Method: Move c'tor
+    * Details: takes over all slabs, original arena is left empty
+    * Parameters: aVal is moved arena
+    */
+    CNodeArena(CNodeArena&& aVal) noexcept : iSlabs(std::move(aVal.iSlabs)) { aVal.iSlabs.clear(); }
+
+    /*
+    * Method: Move assignment operator
+    * Details: destroys own nodes and takes over all slabs, original arena is left empty
+    * Parameters: aVal is moved arena
+    */
+    CNodeArena& operator=(CNodeArena&& aVal) noexcept {
+        if (this == &aVal) return *this;
+        Release();
+        iSlabs = std::move(aVal.iSlabs);
+        aVal.iSlabs.clear();
+        return *this;
+    }
+
+    /*
+    * Method: D'tor
+    * Details: destroys all nodes
+    */
+    ~CNodeArena() { Release(); }
+
+    /*
+    * Method: Reserve
+    * Details: allocates slab for aCount nodes, so the following aCount nodes are placed next to each other (slab has room for one node at least)
+    * Parameters: aCount is expected number of nodes
+    */
+    void Reserve(size_t aCount) {
+        aCount = std::max<size_t>(aCount, 1);
+        if (!iSlabs.empty() && iSlabs.back().iCapacity - iSlabs.back().iUsed >= aCount) return;
+        iSlabs.push_back({ iAllocator.allocate(aCount), aCount, 0 });
+    }
+
+    /*
+    * Method: New node
+    * Details: constructs node from given arguments in the last slab, new slab (twice as large) is allocated when the last one is full
+    * Parameters: aArgs are arguments of node c'tor
+    * Return: pointer on constructed node
+    */
+    template <typename... TArgs>
+    TNode* New(TArgs&&... aArgs) {
+        if (iSlabs.empty() || iSlabs.back().iUsed == iSlabs.back().iCapacity) {
+            Reserve(iSlabs.empty() ? 16 : std::max<size_t>(16, iSlabs.back().iCapacity * 2));
+        }
+        TSlab& slab = iSlabs.back();
+        TNode* node = ::new (static_cast<void*>(slab.iNodes + slab.iUsed)) TNode(std::forward<TArgs>(aArgs)...);
+        ++slab.iUsed;
+        return node;
+    }
+
+    /*
+    * Method: Release
+    * Details: destroys all constructed nodes and frees all slabs
+    */
+    void Release() {
+        for (TSlab& slab : iSlabs) {
+            for (size_t i = 0; i < slab.iUsed; ++i) slab.iNodes[i].~TNode();
+            iAllocator.deallocate(slab.iNodes, slab.iCapacity);
+        }
+        iSlabs.clear();
+    }
+}; /* class CNodeArena */
+
+#endif /* __CNodeArena_H__ */
@@ -0,0 +1,126 @@
+#ifndef __COrderedIndex_H__
+#define __COrderedIndex_H__
+/*
+*  File: COrderedIndex.h
+*  Brief: COrderedIndex class header
+*  Details: File contain sorted index of set values, which is used by CSet for range queries (sections).
+*  Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "CFlatStorage.h"
+#include "CSetAlgebra.h"
+#include "CValidFlag.h"
+
+/*
+ * COrderedIndex class
+ * Details: Sorted array of values (by Order() of CDouble or TPoint) together with their slots in CFlatStorage.
+ * Values, which are not equal to itself (NaN), are left out, because they are never smaller or larger than anything.
+ * Bounds of ranges are found by binary search with operators < and <= of the value type, so range query costs O(log N) plus the size of the result.
+ * Set operations merge indexes of both operands as sorted runs (see Run()).
+ * The index does not follow modifications of the storage, owner has to rebuild it after every modification.
+ */
+template <typename TValue>
+class COrderedIndex {
+    std::vector<TValue> iValues; ///< Sorted values
+    std::vector<size_t> iSlots; ///< Slots of sorted values in the storage
+    size_t iSlotCount = 0; ///< Number of slots of the storage, when the index was built
+    CValidFlag iValid; ///< Index was built for actual content of the storage
+    CValidFlag iRequested; ///< Range query was answered without the index since the last invalidation
+
+public:
+    /*
+    * Method: Valid
+    * Return: true when the index was built and not invalidated since
+    */
+    bool Valid() const { return iValid.Get(); }
+
+    /*
+    * Method: Request
+    * Details: notes that range query was asked, the owner can answer the first query after modification by scanning values and build the index for the next one
+    * Return: true when range query was already asked since the last invalidation
+    */
+    bool Request() { return iRequested.Exchange(true); }
+
+    /*
+    * Method: Invalidate
+    * Details: drops content of the index
+    */
+    void Invalidate() {
+        iValues.clear();
+        iSlots.clear();
+        iSlotCount = 0;
+        iValid.Set(false);
+        iRequested.Set(false);
+    }
+
+    /*
+    * Method: Build
+    * Details: sorts values of the storage
+    * Parameters: aStorage is indexed storage
+    */
+    void Build(const CFlatStorage<TValue>& aStorage) {
+        std::vector<size_t> slots;
+        slots.reserve(aStorage.Size());
+        aStorage.ForEachSlot([&](size_t aSlot, const TValue& aValue) {
+            if (aValue == aValue) slots.push_back(aSlot);
+        });
+        std::sort(slots.begin(), slots.end(), [&](size_t aLeft, size_t aRight) { return aStorage.At(aLeft).Order(aStorage.At(aRight)) < 0; });
+        iValues.clear();
+        iValues.reserve(slots.size());
+        for (size_t slot : slots) iValues.push_back(aStorage.At(slot));
+        iSlots = std::move(slots);
+        iSlotCount = aStorage.SlotCount();
+        iValid.Set(true);
+    }
+
+    /*
+    * Method: Lower bound of range
+    * Parameters: aLow is lower bound, aInclusive selects whether values equal to aLow belong to the range
+    * Return: position of the first sorted value, which is larger (or equal) than aLow
+    */
+    size_t Lower(const TValue& aLow, bool aInclusive) const {
+        if (aInclusive) return std::partition_point(iValues.begin(), iValues.end(), [&](const TValue& aValue) { return !(aLow <= aValue); }) - iValues.begin();
+        return std::partition_point(iValues.begin(), iValues.end(), [&](const TValue& aValue) { return !(aLow < aValue); }) - iValues.begin();
+    }
+
+    /*
+    * Method: Upper bound of range
+    * Parameters: aHigh is upper bound, aInclusive selects whether values equal to aHigh belong to the range
+    * Return: position behind the last sorted value, which is smaller (or equal) than aHigh
+    */
+    size_t Upper(const TValue& aHigh, bool aInclusive) const {
+        if (aInclusive) return std::partition_point(iValues.begin(), iValues.end(), [&](const TValue& aValue) { return aValue <= aHigh; }) - iValues.begin();
+        return std::partition_point(iValues.begin(), iValues.end(), [&](const TValue& aValue) { return aValue < aHigh; }) - iValues.begin();
+    }
+
+    /*
+    * Method: Size
+    * Return: number of indexed values
+    */
+    size_t Size() const { return iValues.size(); }
+
+    /*
+    * Method: Slots of range
+    * Parameters: aFirst and aLast define range of sorted positions
+    * Return: slots of values in the range in the order of the storage (insertion order)
+    */
+    std::vector<size_t> Slots(size_t aFirst, size_t aLast) const {
+        std::vector<size_t> slots(iSlots.begin() + aFirst, iSlots.begin() + aLast);
+        std::sort(slots.begin(), slots.end());
+        return slots;
+    }
+
+    /*
+    * Method: Sorted run
+    * Details: view of the index for merging with index of another set (see CSortedRun), positions of the run are slots of the storage
+    * Return: sorted run, which is valid until the index is invalidated
+    */
+    CSortedRun<TValue> Run() const { return CSortedRun<TValue>(iValues, iSlots, iSlotCount); }
+}; /* class COrderedIndex */
+
+#endif /* __COrderedIndex_H__ */
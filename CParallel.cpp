@@ -0,0 +1,119 @@
+/*
+* File: CParallel.cpp
+* Brief description: CParallel class implementation
+* Details: File contain splitting of loops over large arrays between worker threads, which is used by CSet for operations on large sets.
+* Author: Martin Bezecny
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "CParallel.h"
+
+// Internal functions
+
+static std::atomic<size_t>& Selected() {
+    static std::atomic<size_t> selected{ 0 }; // 0 selects number of hardware threads
+    return selected;
+}
+
+/*
+ * Parallel loop shared by the calling thread and threads of the pool, chunks are taken by increasing of iNext
+ */
+struct TJob {
+    const std::function<void(size_t)>& iTask; ///< Function called for every chunk
+    size_t iChunks; ///< Number of chunks
+    std::atomic<size_t> iNext{ 0 }; ///< Index of the next chunk, which was not taken yet
+    std::atomic<size_t> iDone{ 0 }; ///< Number of finished chunks
+
+    TJob(const std::function<void(size_t)>& aTask, size_t aChunks) : iTask(aTask), iChunks(aChunks) {}
+
+    // takes and processes chunks until all of them are taken, returns false when no chunk was left
+    bool Work(std::mutex& aLock, std::condition_variable& aFinished) {
+        size_t chunk = iNext.fetch_add(1);
+        if (chunk >= iChunks) return false;
+        do {
+            iTask(chunk);
+            if (iDone.fetch_add(1) + 1 == iChunks) {
+                std::lock_guard<std::mutex> lock(aLock);
+                aFinished.notify_all();
+            }
+        } while ((chunk = iNext.fetch_add(1)) < iChunks);
+        return true;
+    }
+};
+
+/*
+ * Pool of threads processing chunks of loops, threads are started when a loop needs them and they are stopped at exit of the program
+ */
+class CPool {
+    std::mutex iLock; ///< Lock of the queue
+    std::condition_variable iWake; ///< Signals new loop or stop to threads of the pool
+    std::condition_variable iFinished; ///< Signals finished loop to the calling threads
+    std::deque<std::shared_ptr<TJob>> iJobs; ///< Loops which still may have chunks not taken
+    std::vector<std::thread> iThreads; ///< Threads of the pool
+    bool iStop = false; ///< Threads have to finish
+
+    void Loop() {
+        std::unique_lock<std::mutex> lock(iLock);
+        for (;;) {
+            iWake.wait(lock, [&]() { return iStop || !iJobs.empty(); });
+            if (iStop) return;
+            std::shared_ptr<TJob> job = iJobs.front(); // shared, so it stays valid after the loop finished
+            lock.unlock();
+            bool worked = job->Work(iLock, iFinished);
+            lock.lock();
+            if (!worked && !iJobs.empty() && iJobs.front() == job) iJobs.pop_front();
+        }
+    }
+
+public:
+    ~CPool() {
+        {
+            std::lock_guard<std::mutex> lock(iLock);
+            iStop = true;
+        }
+        iWake.notify_all();
+        for (std::thread& thread : iThreads) thread.join();
+    }
+
+    void Run(size_t aChunks, const std::function<void(size_t)>& aTask) {
+        std::shared_ptr<TJob> job = std::make_shared<TJob>(aTask, aChunks);
+        {
+            std::lock_guard<std::mutex> lock(iLock);
+            while (iThreads.size() + 1 < aChunks) iThreads.emplace_back(&CPool::Loop, this);
+            iJobs.push_back(job);
+        }
+        iWake.notify_all();
+        job->Work(iLock, iFinished);
+        std::unique_lock<std::mutex> lock(iLock);
+        iFinished.wait(lock, [&]() { return job->iDone.load() == aChunks; });
+        for (auto it = iJobs.begin(); it != iJobs.end(); ++it) {
+            if (*it == job) {
+                iJobs.erase(it);
+                break;
+            }
+        }
+    }
+};
+
+// Definitions of class methods
+
+size_t CParallel::Workers() {
+    size_t workers = Selected().load(std::memory_order_relaxed);
+    if (workers == 0) workers = std::thread::hardware_concurrency();
+    return (workers == 0) ? 1 : workers;
+}
+
+void CParallel::Use(size_t aWorkers) {
+    Selected().store(aWorkers, std::memory_order_relaxed);
+}
+
+void CParallel::Run(size_t aChunks, const std::function<void(size_t)>& aTask) {
+    static CPool pool;
+    pool.Run(aChunks, aTask);
+}
@@ -0,0 +1,81 @@
+#ifndef __CParallel_H__
+#define __CParallel_H__
+/*
+*  File: CParallel.h
+*  Brief: CParallel class header
+*  Details: File contain splitting of loops over large arrays between worker threads, which is used by CSet for operations on large sets.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <vector>
+
+/*
+ * CParallel class
+ * Details: Range of indices is split into equal contiguous chunks, which are processed by threads of a pool and by the calling thread.
+ * The pool is started by the first parallel loop and reused by later ones, so loops do not pay for starting threads.
+ * The calling thread takes chunks as well, so a loop finishes even when all threads of the pool are busy (for example by nested loops).
+ * Loops shorter than two minimal chunks run in the calling thread only.
+ * Exception thrown by any chunk is rethrown in the calling thread after all chunks finished.
+ */
+class CParallel
+	{
+public:
+    /*
+    * Method: Workers
+    * Return: maximal number of threads used by one loop
+    */
+    static size_t Workers();
+
+    /*
+    * Method: Select number of workers
+    * Details: it must not be called while loops run in other threads
+    * Parameters: aWorkers is maximal number of threads used by one loop, 0 selects number of hardware threads
+    */
+    static void Use(size_t aWorkers);
+
+    /*
+    * Method: Chunks
+    * Parameters: aCount is number of indices, aMinChunk is minimal number of indices processed by one thread
+    * Return: number of chunks, which For() splits the range into
+    */
+    static size_t Chunks(size_t aCount, size_t aMinChunk) {
+        size_t chunks = aCount / (aMinChunk ? aMinChunk : 1);
+        return (chunks < 2) ? 1 : (chunks < Workers() ? chunks : Workers());
+    }
+
+    /*
+    * Method: For
+    * Details: calls given function for chunks of range [0, aCount), chunks may run at the same time
+    * Parameters: aCount is number of indices, aMinChunk is minimal number of indices processed by one thread,
+    * aFunc is callable with size_t begin and size_t end parameters
+    */
+    template <typename TFunc>
+    static void For(size_t aCount, size_t aMinChunk, TFunc aFunc) {
+        size_t chunks = Chunks(aCount, aMinChunk);
+        if (chunks == 1) {
+            aFunc(size_t(0), aCount);
+            return;
+        }
+        std::vector<std::exception_ptr> errors(chunks);
+        Run(chunks, [&](size_t aChunk) {
+            try { aFunc(aCount * aChunk / chunks, aCount * (aChunk + 1) / chunks); }
+            catch (...) { errors[aChunk] = std::current_exception(); }
+        });
+        for (const std::exception_ptr& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+    }
+
+private:
+    /*
+    * Method: Run
+    * Details: calls aTask for every chunk index of [0, aChunks) on threads of the pool and on the calling thread,
+    * returns after all chunks finished, aTask must not throw
+    */
+    static void Run(size_t aChunks, const std::function<void(size_t)>& aTask);
+	}; /* class CParallel */
+
+#endif /* __CParallel_H__ */
@@ -0,0 +1,275 @@
+/*
+* File: CPersistentSet.cpp
+* Brief description: CPersistentSet class implementation
+* Details: File contain immutable set container, whose versions share structure.
+* Author: Martin Bezecny
+*/
+
+#include <algorithm>
+
+#include "CPersistentSet.h"
+#include "CEntity_CDouble.h"
+#include "CEntity_TPoint.h"
+
+// Internal functions
+
+/*
+ * Bit of the value position
+ * Return: bit of map selected by hash bits of given level
+ */
+static uint32_t BitOf(uint64_t aHash, unsigned aShift) {
+    return uint32_t(1) << ((aHash >> aShift) & 31);
+}
+
+// Definitions of class methods
+
+template <typename TElement>
+uint64_t CPersistentSetT<TElement>::Mix(const TValue& aValue) {
+    uint64_t h = static_cast<uint64_t>(aValue.Hash());
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+template <typename TElement>
+typename CPersistentSetT<TElement>::TNodePtr CPersistentSetT<TElement>::Pair(const TValue& aFirst, uint64_t aFirstHash, const TValue& aSecond, uint64_t aSecondHash, unsigned aShift) {
+    auto node = std::make_shared<TNode>();
+    if (aShift >= KHashBits) {
+        node->iValues = { aFirst, aSecond };
+        return node;
+    }
+    uint32_t first = BitOf(aFirstHash, aShift), second = BitOf(aSecondHash, aShift);
+    if (first == second) {
+        node->iNodeMap = first;
+        node->iNodes.push_back(Pair(aFirst, aFirstHash, aSecond, aSecondHash, aShift + KBits));
+    }
+    else {
+        node->iValueMap = first | second;
+        node->iValues = (first < second) ? std::vector<TValue>{ aFirst, aSecond } : std::vector<TValue>{ aSecond, aFirst };
+    }
+    return node;
+}
+
+template <typename TElement>
+typename CPersistentSetT<TElement>::TNodePtr CPersistentSetT<TElement>::Insert(const TNode* aNode, const TValue& aValue, uint64_t aHash, unsigned aShift) {
+    if (aNode == nullptr) {
+        auto node = std::make_shared<TNode>();
+        node->iValueMap = BitOf(aHash, aShift);
+        node->iValues.push_back(aValue);
+        return node;
+    }
+    if (aShift >= KHashBits) {
+        if (std::find(aNode->iValues.begin(), aNode->iValues.end(), aValue) != aNode->iValues.end()) return nullptr;
+        auto node = std::make_shared<TNode>(*aNode);
+        node->iValues.push_back(aValue);
+        return node;
+    }
+    uint32_t bit = BitOf(aHash, aShift);
+    if (aNode->iNodeMap & bit) {
+        size_t index = Index(aNode->iNodeMap, bit);
+        TNodePtr child = Insert(aNode->iNodes[index].get(), aValue, aHash, aShift + KBits);
+        if (!child) return nullptr;
+        auto node = std::make_shared<TNode>(*aNode);
+        node->iNodes[index] = std::move(child);
+        return node;
+    }
+    auto node = std::make_shared<TNode>(*aNode);
+    size_t index = Index(aNode->iValueMap, bit);
+    if (aNode->iValueMap & bit) {
+        const TValue& present = aNode->iValues[index];
+        if (present == aValue) return nullptr;
+        // two values at one position are moved into new subtree of the next level
+        node->iNodes.insert(node->iNodes.begin() + Index(aNode->iNodeMap, bit), Pair(present, Mix(present), aValue, aHash, aShift + KBits));
+        node->iValues.erase(node->iValues.begin() + index);
+        node->iValueMap &= ~bit;
+        node->iNodeMap |= bit;
+    }
+    else {
+        node->iValues.insert(node->iValues.begin() + index, aValue);
+        node->iValueMap |= bit;
+    }
+    return node;
+}
+
+template <typename TElement>
+typename CPersistentSetT<TElement>::TNodePtr CPersistentSetT<TElement>::Remove(const TNodePtr& aNode, const TValue& aValue, uint64_t aHash, unsigned aShift, bool& aFound) {
+    if (aShift >= KHashBits) {
+        auto found = std::find(aNode->iValues.begin(), aNode->iValues.end(), aValue);
+        if (found == aNode->iValues.end()) return aNode;
+        aFound = true;
+        if (aNode->iValues.size() == 1) return nullptr;
+        auto node = std::make_shared<TNode>(*aNode);
+        node->iValues.erase(node->iValues.begin() + (found - aNode->iValues.begin()));
+        return node;
+    }
+    uint32_t bit = BitOf(aHash, aShift);
+    if (aNode->iValueMap & bit) {
+        size_t index = Index(aNode->iValueMap, bit);
+        if (!(aNode->iValues[index] == aValue)) return aNode;
+        aFound = true;
+        if (aNode->iValues.size() == 1 && aNode->iNodes.empty()) return nullptr;
+        auto node = std::make_shared<TNode>(*aNode);
+        node->iValues.erase(node->iValues.begin() + index);
+        node->iValueMap &= ~bit;
+        return node;
+    }
+    if (aNode->iNodeMap & bit) {
+        size_t index = Index(aNode->iNodeMap, bit);
+        TNodePtr child = Remove(aNode->iNodes[index], aValue, aHash, aShift + KBits, aFound);
+        if (child == aNode->iNodes[index]) return aNode;
+        auto node = std::make_shared<TNode>(*aNode);
+        if (child && !Single(*child)) {
+            node->iNodes[index] = std::move(child);
+            return node;
+        }
+        // subtree with single value is merged into this node, so the trie stays canonical
+        node->iNodes.erase(node->iNodes.begin() + index);
+        node->iNodeMap &= ~bit;
+        if (child) {
+            node->iValues.insert(node->iValues.begin() + Index(node->iValueMap, bit), child->iValues.front());
+            node->iValueMap |= bit;
+        }
+        else if (node->iValues.empty() && node->iNodes.empty()) return nullptr;
+        return node;
+    }
+    return aNode;
+}
+
+template <typename TElement>
+bool CPersistentSetT<TElement>::Contains(const TNode* aNode, const TValue& aValue, uint64_t aHash, unsigned aShift) {
+    for (; aShift < KHashBits; aShift += KBits) {
+        uint32_t bit = BitOf(aHash, aShift);
+        if (aNode->iValueMap & bit) return aNode->iValues[Index(aNode->iValueMap, bit)] == aValue;
+        if (!(aNode->iNodeMap & bit)) return false;
+        aNode = aNode->iNodes[Index(aNode->iNodeMap, bit)].get();
+    }
+    return std::find(aNode->iValues.begin(), aNode->iValues.end(), aValue) != aNode->iValues.end();
+}
+
+template <typename TElement>
+void CPersistentSetT<TElement>::Diff(const TValue& aValue, const TNode* aNode, std::vector<TValue>& aOnlyValue, std::vector<TValue>& aOnlyNode) {
+    bool found = false;
+    auto collect = [&](const TValue& aOther) {
+        if (!found && aOther == aValue) found = true;
+        else aOnlyNode.push_back(aOther);
+    };
+    Walk(aNode, collect);
+    if (!found) aOnlyValue.push_back(aValue);
+}
+
+template <typename TElement>
+void CPersistentSetT<TElement>::Diff(const TNode* aOld, const TNode* aNew, unsigned aShift, std::vector<TValue>& aAdded, std::vector<TValue>& aRemoved) {
+    if (aOld == aNew) return;
+    auto added = [&](const TValue& aValue) { aAdded.push_back(aValue); };
+    auto removed = [&](const TValue& aValue) { aRemoved.push_back(aValue); };
+    if (aOld == nullptr) {
+        Walk(aNew, added);
+        return;
+    }
+    if (aNew == nullptr) {
+        Walk(aOld, removed);
+        return;
+    }
+    if (aShift >= KHashBits) {
+        for (const TValue& value : aNew->iValues) {
+            if (std::find(aOld->iValues.begin(), aOld->iValues.end(), value) == aOld->iValues.end()) aAdded.push_back(value);
+        }
+        for (const TValue& value : aOld->iValues) {
+            if (std::find(aNew->iValues.begin(), aNew->iValues.end(), value) == aNew->iValues.end()) aRemoved.push_back(value);
+        }
+        return;
+    }
+    for (uint32_t positions = aOld->iValueMap | aOld->iNodeMap | aNew->iValueMap | aNew->iNodeMap; positions != 0; positions &= positions - 1) {
+        uint32_t bit = positions & (~positions + 1);
+        const TValue* oldValue = (aOld->iValueMap & bit) ? &aOld->iValues[Index(aOld->iValueMap, bit)] : nullptr;
+        const TValue* newValue = (aNew->iValueMap & bit) ? &aNew->iValues[Index(aNew->iValueMap, bit)] : nullptr;
+        const TNode* oldNode = (aOld->iNodeMap & bit) ? aOld->iNodes[Index(aOld->iNodeMap, bit)].get() : nullptr;
+        const TNode* newNode = (aNew->iNodeMap & bit) ? aNew->iNodes[Index(aNew->iNodeMap, bit)].get() : nullptr;
+        if (oldValue && newValue) {
+            if (!(*oldValue == *newValue)) {
+                aRemoved.push_back(*oldValue);
+                aAdded.push_back(*newValue);
+            }
+        }
+        else if (oldValue) {
+            if (newNode) Diff(*oldValue, newNode, aRemoved, aAdded);
+            else aRemoved.push_back(*oldValue);
+        }
+        else if (newValue) {
+            if (oldNode) Diff(*newValue, oldNode, aAdded, aRemoved);
+            else aAdded.push_back(*newValue);
+        }
+        else Diff(oldNode, newNode, aShift + KBits, aAdded, aRemoved);
+    }
+}
+
+template <typename TElement>
+CPersistentSetT<TElement>::CPersistentSetT(const CSet& aSet) {
+    for (const TValue& value : aSet) *this = add(value);
+}
+
+template <typename TElement>
+CPersistentSetT<TElement> CPersistentSetT<TElement>::add(const TValue& aVal) const {
+    TNodePtr root = Insert(iRoot.get(), aVal, Mix(aVal), 0);
+    if (!root) return *this;
+    return CPersistentSetT(std::move(root), iCount + 1);
+}
+
+template <typename TElement>
+CPersistentSetT<TElement> CPersistentSetT<TElement>::erase(const TValue& aVal) const {
+    if (!iRoot) return *this;
+    bool found = false;
+    TNodePtr root = Remove(iRoot, aVal, Mix(aVal), 0, found);
+    if (!found) return *this;
+    return CPersistentSetT(std::move(root), iCount - 1);
+}
+
+template <typename TElement>
+bool CPersistentSetT<TElement>::is_element_of(const TValue& aVal) const {
+    return iRoot && Contains(iRoot.get(), aVal, Mix(aVal), 0);
+}
+
+template <typename TElement>
+void CPersistentSetT<TElement>::diff(const CPersistentSetT& aOlder, std::vector<TValue>& aAdded, std::vector<TValue>& aRemoved) const {
+    Diff(aOlder.iRoot.get(), iRoot.get(), 0, aAdded, aRemoved);
+}
+
+template <typename TElement>
+CSetT<TElement> CPersistentSetT<TElement>::snapshot() const {
+    CSet result;
+    for_each([&](const TValue& aValue) { result.add(CEntity(aValue)); });
+    return result;
+}
+
+template <typename TElement>
+bool CPersistentSetT<TElement>::operator ==(const CPersistentSetT& aVal) const {
+    if (iCount != aVal.iCount) return false;
+    std::vector<TValue> added, removed;
+    diff(aVal, added, removed);
+    return added.empty() && removed.empty();
+}
+
+template <typename TType>
+std::istream& operator >>(std::istream& aIStream, CPersistentSetT<TType>& aValue) {
+    CSetT<TType> set;
+    if (aIStream >> set) aValue = CPersistentSetT<TType>(set);
+    return aIStream;
+}
+
+template <typename TType>
+std::ostream& operator <<(std::ostream& aOStream, const CPersistentSetT<TType>& aValue) {
+    return aOStream << aValue.snapshot();
+}
+
+// Explicit instantiations for supported value types (see TSetTraits)
+
+template class CPersistentSetT<CEntity_CDouble::CDouble>;
+template class CPersistentSetT<CEntity_TPoint::TPoint>;
+
+template std::istream& operator >>(std::istream& aIStream, CPersistentSetT<CEntity_CDouble::CDouble>& aValue);
+template std::istream& operator >>(std::istream& aIStream, CPersistentSetT<CEntity_TPoint::TPoint>& aValue);
+template std::ostream& operator <<(std::ostream& aOStream, const CPersistentSetT<CEntity_CDouble::CDouble>& aValue);
+template std::ostream& operator <<(std::ostream& aOStream, const CPersistentSetT<CEntity_TPoint::TPoint>& aValue);
@@ -0,0 +1,249 @@
+#ifndef __CPersistentSet_H__
+#define __CPersistentSet_H__
+/*
+*  File: CPersistentSet.h
+*  Brief: CPersistentSet class header
+*  Details: File contain immutable set container, whose versions share structure.
+*  Author: Martin Bezecny
+*/
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CSet.h"
+
+/*
+ * CPersistentSetT class
+ * Details: Values are kept in hash array mapped trie (CHAMP variant): every node branches by 5 bits of mixed hash,
+ * values are stored inline in the nodes and subtrees are referenced by shared pointers. Nodes are never modified,
+ * so add() and erase() return new version of the set, which copies only the path from the root to the changed value
+ * (O(log N) memory) and shares all other nodes with the old version. Copying the set copies only the root pointer.
+ * Erase keeps the trie in canonical form (node with single value is merged into its parent), so equal sets have
+ * equal shape and diff() of two versions skips all shared subtrees.
+ * Values are matched by operator== (tolerance of CSet is not supported).
+ * Versions can be read from any threads, the set is only as thread-safe as std::shared_ptr.
+ * Element type is template parameter as in CSetT, member functions are defined in CPersistentSet.cpp and instantiated there for both supported types.
+ */
+template <typename TElement>
+class CPersistentSetT
+	{
+public:
+    using CSet = CSetT<TElement>; ///< Type of ordinary sets
+    using CEntity = typename CSet::CEntity; ///< Node class of the set
+    using TValue = TElement; ///< Type of stored values
+
+private:
+    static constexpr unsigned KBits = 5; ///< Number of hash bits consumed by one level
+    static constexpr unsigned KHashBits = 64; ///< Number of bits of mixed hash, nodes below them keep colliding values in plain list
+
+    struct TNode;
+    using TNodePtr = std::shared_ptr<const TNode>; ///< Shared reference of node
+
+    /*
+    * Node of trie
+    * Details: entries are ordered by their hash bits, bit of iValueMap or iNodeMap marks position of value or subtree.
+    * Collision node (below all hash bits) has both maps empty and keeps unordered list of values.
+    */
+    struct TNode {
+        uint32_t iValueMap = 0; ///< Positions of inline values
+        uint32_t iNodeMap = 0; ///< Positions of subtrees
+        std::vector<TValue> iValues; ///< Inline values
+        std::vector<TNodePtr> iNodes; ///< Subtrees
+    };
+
+    TNodePtr iRoot; ///< Root node, nullptr for empty set
+    size_t iCount = 0; ///< Number of values
+
+    CPersistentSetT(TNodePtr aRoot, size_t aCount) : iRoot(std::move(aRoot)), iCount(aCount) {}
+
+    /*
+    * Method: Mix
+    * Return: mixed hash of the value
+    */
+    static uint64_t Mix(const TValue& aValue);
+
+    /*
+    * Method: Index in map
+    * Return: number of entries before given bit of the map
+    */
+    static size_t Index(uint32_t aMap, uint32_t aBit) { return size_t(std::popcount(aMap & (aBit - 1))); }
+
+    /*
+    * Method: Insert
+    * Parameters: aNode is node at given level (may be nullptr), aValue is inserted value, aHash its mixed hash, aShift bit position of the level
+    * Return: new node with the value, or nullptr when the value is present already
+    */
+    static TNodePtr Insert(const TNode* aNode, const TValue& aValue, uint64_t aHash, unsigned aShift);
+
+    /*
+    * Method: Pair
+    * Return: new subtree with two different values
+    */
+    static TNodePtr Pair(const TValue& aFirst, uint64_t aFirstHash, const TValue& aSecond, uint64_t aSecondHash, unsigned aShift);
+
+    /*
+    * Method: Remove
+    * Details: result node with single value is returned as is, parent merges it into itself
+    * Parameters: aNode is node at given level, aValue is erased value, aHash its mixed hash, aShift bit position of the level, aFound is set when the value was present
+    * Return: new node without the value (nullptr when it became empty), or aNode when the value is not present
+    */
+    static TNodePtr Remove(const TNodePtr& aNode, const TValue& aValue, uint64_t aHash, unsigned aShift, bool& aFound);
+
+    /*
+    * Method: Single value
+    * Return: true when the node holds just one value and no subtree
+    */
+    static bool Single(const TNode& aNode) { return aNode.iNodes.empty() && aNode.iValues.size() == 1; }
+
+    /*
+    * Method: Contains
+    * Return: true when the subtree holds the value
+    */
+    static bool Contains(const TNode* aNode, const TValue& aValue, uint64_t aHash, unsigned aShift);
+
+    /*
+    * Method: For each value
+    * Parameters: aNode is walked subtree, aFunc is callable with const TValue& parameter
+    */
+    template <typename TFunc>
+    static void Walk(const TNode* aNode, TFunc& aFunc);
+
+    /*
+    * Method: Diff
+    * Details: compares subtrees at the same position of two tries, shared subtrees are skipped
+    * Parameters: aOld and aNew are compared subtrees (may be nullptr), aShift bit position of the level, aAdded and aRemoved collect the differences
+    */
+    static void Diff(const TNode* aOld, const TNode* aNew, unsigned aShift, std::vector<TValue>& aAdded, std::vector<TValue>& aRemoved);
+
+    /*
+    * Method: Diff of value and subtree
+    * Parameters: aValue is single value at the position in one version, aNode subtree at the position in the other one,
+    * aOnlyValue collects aValue when the subtree does not hold it, aOnlyNode collects other values of the subtree
+    */
+    static void Diff(const TValue& aValue, const TNode* aNode, std::vector<TValue>& aOnlyValue, std::vector<TValue>& aOnlyNode);
+
+public:
+    /*
+    * Method: C'tor
+    * Details: creates empty set
+    */
+    CPersistentSetT() = default;
+
+    /*
+    * Method: C'tor
+    * Details: creates set with values of given set
+    * Parameters: aSet is copied set
+    */
+    explicit CPersistentSetT(const CSet& aSet);
+
+    /*
+    * Method: Number of elements
+    * Return: number of values in the set
+    */
+    size_t num_of_elements() const { return iCount; }
+
+    /*
+    * Method: Is empty
+    * Return: true when the set has no values
+    */
+    bool is_empty() const { return iCount == 0; }
+
+    /*
+    * Method: Add element
+    * Details: this version is not changed
+    * Parameters: aVal is added element
+    * Return: version with the value, it shares all nodes out of the path to the value (the same version when the value is present)
+    */
+    [[nodiscard]] CPersistentSetT add(const TValue& aVal) const;
+    [[nodiscard]] CPersistentSetT add(const CEntity& aVal) const { return add(aVal.Value()); }
+
+    /*
+    * Method: Erase element
+    * Details: this version is not changed
+    * Parameters: aVal is erased element
+    * Return: version without the value, it shares all nodes out of the path to the value (the same version when the value is not present)
+    */
+    [[nodiscard]] CPersistentSetT erase(const TValue& aVal) const;
+    [[nodiscard]] CPersistentSetT erase(const CEntity& aVal) const { return erase(aVal.Value()); }
+
+    /*
+    * Method: Is element of
+    * Parameters: aVal is searched element
+    * Return: true when the value is present
+    */
+    bool is_element_of(const TValue& aVal) const;
+    bool is_element_of(const CEntity& aVal) const { return is_element_of(aVal.Value()); }
+
+    /*
+    * Method: Shares structure
+    * Return: true when both versions have the same root, so they are equal without comparing values
+    */
+    bool shares(const CPersistentSetT& aVal) const { return iRoot == aVal.iRoot; }
+
+    /*
+    * Method: Diff
+    * Details: time depends on size of the change, subtrees shared by both versions are not visited
+    * Parameters: aOlder is compared version, aAdded gets values present only in this version, aRemoved values present only in aOlder
+    */
+    void diff(const CPersistentSetT& aOlder, std::vector<TValue>& aAdded, std::vector<TValue>& aRemoved) const;
+
+    /*
+    * Method: Snapshot
+    * Return: ordinary set with values of this version (in no particular order)
+    */
+    CSet snapshot() const;
+
+    /*
+    * Method: For each value
+    * Parameters: aFunc is callable with const TValue& parameter called for every value
+    */
+    template <typename TFunc>
+    void for_each(TFunc aFunc) const { if (iRoot) Walk(iRoot.get(), aFunc); }
+
+    /*
+    * Method: Comparison operator
+    * Return: true when both versions hold the same values
+    */
+    bool operator ==(const CPersistentSetT& aVal) const;
+
+    /*
+    * Method: friend input operator
+    * Details: reads set in the text format of CSet
+    * Parameters: aIStream is input stream, aValue is the read set
+    * Return: input stream
+    */
+    template <typename TType>
+    friend std::istream& operator >>(std::istream& aIStream, CPersistentSetT<TType>& aValue);
+
+    /*
+    * Method: friend output operator
+    * Details: writes set in the text format of CSet
+    * Parameters: aOStream is output stream, aValue is the written set
+    * Return: output stream
+    */
+    template <typename TType>
+    friend std::ostream& operator <<(std::ostream& aOStream, const CPersistentSetT<TType>& aValue);
+	}; /* class CPersistentSetT */
+
+template <typename TElement>
+template <typename TFunc>
+void CPersistentSetT<TElement>::Walk(const TNode* aNode, TFunc& aFunc) {
+    for (const TValue& value : aNode->iValues) aFunc(value);
+    for (const TNodePtr& node : aNode->iNodes) Walk(node.get(), aFunc);
+}
+
+/*
+ * CPersistentSet type
+ * Persistent set of the CEntity variant selected in CEntity.h
+ */
+using CPersistentSet = CPersistentSetT<CSet::TValue>;
+
+extern template class CPersistentSetT<CEntity_CDouble::CDouble>;
+extern template class CPersistentSetT<CEntity_TPoint::TPoint>;
+
+#endif /* __CPersistentSet_H__ */
@@ -0,0 +1,95 @@
+#ifndef __CPointColumns_H__
+#define __CPointColumns_H__
+/*
+*  File: CPointColumns.h
+*  Brief: CPointColumns class header
+*  Details: File contain structure of arrays with coordinates of TPoint values, which is used by CSet for vectorized spatial queries.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include "CEntity_TPoint.h"
+#include "CValidFlag.h"
+
+/*
+ * CPointColumns class
+ * Details: Columns exist only for TPoint values, for other value types the class is empty and never valid.
+ */
+template <typename TValue>
+class CPointColumns {
+public:
+    bool Valid() const { return false; }
+    void Invalidate() {}
+}; /* class CPointColumns */
+
+/*
+ * CPointColumns class for TPoint values
+ * Details: Coordinates and cached distances from the origin of all slots of CFlatStorage are copied into separate arrays (dead slots included,
+ * so position in the columns is the slot), vectorized kernels (see CDoubleKernels) then read whole vectors of one coordinate at once.
+ * Columns do not follow modifications of the storage, owner has to rebuild them after every modification.
+ */
+template <>
+class CPointColumns<CEntity_TPoint::TPoint> {
+    std::vector<double> iX; ///< X coordinates
+    std::vector<double> iY; ///< Y coordinates
+    std::vector<double> iZ; ///< Z coordinates
+    std::vector<double> iNorm; ///< Distances from the origin
+    CValidFlag iValid; ///< Columns were built for actual content of the storage
+
+public:
+    /*
+    * Method: Valid
+    * Return: true when the columns were built and not invalidated since
+    */
+    bool Valid() const { return iValid.Get(); }
+
+    /*
+    * Method: Invalidate
+    * Details: drops content of the columns
+    */
+    void Invalidate() {
+        iX.clear();
+        iY.clear();
+        iZ.clear();
+        iNorm.clear();
+        iValid.Set(false);
+    }
+
+    /*
+    * Method: Build
+    * Details: copies coordinates of all slots into columns
+    * Parameters: aData is array of slots, aCount is number of slots
+    */
+    void Build(const CEntity_TPoint::TPoint* aData, size_t aCount) {
+        iX.resize(aCount);
+        iY.resize(aCount);
+        iZ.resize(aCount);
+        iNorm.resize(aCount);
+        for (size_t i = 0; i < aCount; ++i) {
+            iX[i] = aData[i].X();
+            iY[i] = aData[i].Y();
+            iZ[i] = aData[i].Z();
+            iNorm[i] = aData[i].Norm();
+        }
+        iValid.Set(true);
+    }
+
+    /*
+    * Method: Size
+    * Return: number of slots in the columns
+    */
+    size_t Size() const { return iNorm.size(); }
+
+    /*
+    * Method: Column getters
+    * Return: arrays of X, Y, Z coordinates and distances from the origin
+    */
+    const double* X() const { return iX.data(); }
+    const double* Y() const { return iY.data(); }
+    const double* Z() const { return iZ.data(); }
+    const double* Norm() const { return iNorm.data(); }
+}; /* class CPointColumns<TPoint> */
+
+#endif /* __CPointColumns_H__ */
@@ -5,51 +5,286 @@
 * Author: Martin Bezecny
 */
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+
 #include "CSet.h"
+#include "CEntity_CDouble.h"
+#include "CEntity_TPoint.h"
+#include "CDoubleKernels.h"
+#include "CParallel.h"
+
+static_assert(std::forward_iterator<CSet::const_iterator>, "CSet::const_iterator has to be forward iterator");
+static_assert(std::ranges::forward_range<const CSet>, "CSet has to be forward range");
 
 // Internal functions
 
-void CSet::Copy(const CSet& aVal) { //Function for copying sets
-    CEntity* temp1 = aVal.iFirst;
-    if (aVal.iFirst) {
-        iFirst = new CEntity(*aVal.iFirst);
-        temp1 = dynamic_cast<CEntity*>(aVal.iFirst->NextItem());
+// Vectorized kernels for CDouble values and TPoint columns, generic templates leave other value types to generic code
+using TPackedDouble = CEntity_CDouble::CDouble;
+using TPoint = CEntity_TPoint::TPoint;
+
+static_assert(sizeof(TPackedDouble) == sizeof(double) && std::is_standard_layout_v<TPackedDouble>, "CDouble values have to be packed doubles for vectorized kernels");
+
+static constexpr size_t KLinearContains = 16; ///< Maximal size of set, for which contains_many compares candidates with all elements
+static constexpr size_t KParallelChunk = 1 << 15; ///< Minimal number of elements probed by one thread of set operations
+static constexpr size_t KRebuildShare = 4; ///< Values appended to non-empty set rebuild its index only when they are at least 1/KRebuildShare of its size, fewer values are inserted one by one
+
+template <typename TValue>
+static bool NegateValues(CFlatStorage<TValue>&) { return false; }
+
+[[maybe_unused]] static bool NegateValues(CFlatStorage<TPackedDouble>& aValues) {
+    aValues.TransformSlots([](TPackedDouble* aData, size_t aCount) { CDoubleKernels::Negate(reinterpret_cast<double*>(aData), aCount); });
+    return true;
+}
+
+static void CompareRange(const double* aValues, size_t aCount, const double* aLow, bool aLowInclusive, const double* aHigh, bool aHighInclusive, std::vector<uint64_t>& aMask) {
+    using TCompare = CDoubleKernels::TCompare;
+    aMask.assign((aCount + 63) / 64, ~uint64_t(0));
+    std::vector<uint64_t> bound(aMask.size());
+    if (aLow) {
+        CDoubleKernels::Compare(aValues, aCount, aLowInclusive ? TCompare::GreaterEqual : TCompare::Greater, *aLow, bound.data());
+        for (size_t i = 0; i < aMask.size(); ++i) aMask[i] &= bound[i];
     }
-    CEntity* temp2 = iFirst;
-    while (temp1) {
-        temp2->SetNextItem(new CEntity(*temp1));
-        temp2 = dynamic_cast<CEntity*>(temp2->NextItem());
-        temp1 = dynamic_cast<CEntity*>(temp1->NextItem());
+    if (aHigh) {
+        CDoubleKernels::Compare(aValues, aCount, aHighInclusive ? TCompare::LessEqual : TCompare::Less, *aHigh, bound.data());
+        for (size_t i = 0; i < aMask.size(); ++i) aMask[i] &= bound[i];
     }
-    iSize = aVal.iSize;
 }
 
-void CSet::Destroy() { //function for deallocating sets
-    CEntity* temp = iFirst, * next;
+// Columns are built on demand by const methods, so they are built under lock of the set and published by their valid flag
+[[maybe_unused]] static void BuildColumns(const CFlatStorage<TPoint>& aValues, CPointColumns<TPoint>& aColumns, std::mutex& aLock) {
+    if (aColumns.Valid()) return;
+    std::lock_guard<std::mutex> lock(aLock);
+    if (!aColumns.Valid()) aColumns.Build(aValues.Data(), aValues.SlotCount());
+}
+
+template <typename TValue>
+static bool ScanRange(const CFlatStorage<TValue>&, CPointColumns<TValue>&, std::mutex&, const std::type_identity_t<TValue>*, bool, const std::type_identity_t<TValue>*, bool, std::vector<uint64_t>&) { return false; }
+
+[[maybe_unused]] static bool ScanRange(const CFlatStorage<TPackedDouble>& aValues, CPointColumns<TPackedDouble>&, std::mutex&, const TPackedDouble* aLow, bool aLowInclusive, const TPackedDouble* aHigh, bool aHighInclusive, std::vector<uint64_t>& aMask) {
+    CompareRange(reinterpret_cast<const double*>(aValues.Data()), aValues.SlotCount(), reinterpret_cast<const double*>(aLow), aLowInclusive, reinterpret_cast<const double*>(aHigh), aHighInclusive, aMask);
+    return true;
+}
+
+[[maybe_unused]] static bool ScanRange(const CFlatStorage<TPoint>& aValues, CPointColumns<TPoint>& aColumns, std::mutex& aLock, const TPoint* aLow, bool aLowInclusive, const TPoint* aHigh, bool aHighInclusive, std::vector<uint64_t>& aMask) {
+    BuildColumns(aValues, aColumns, aLock);
+    double low = aLow ? aLow->Norm() : 0, high = aHigh ? aHigh->Norm() : 0;
+    CompareRange(aColumns.Norm(), aColumns.Size(), aLow ? &low : nullptr, aLowInclusive, aHigh ? &high : nullptr, aHighInclusive, aMask);
+    return true;
+}
+
+template <typename TValue>
+static bool ScanWithin(const CFlatStorage<TValue>&, CPointColumns<TValue>&, std::mutex&, const TValue&, double, std::vector<uint64_t>&) { return false; }
+
+[[maybe_unused]] static bool ScanWithin(const CFlatStorage<TPoint>& aValues, CPointColumns<TPoint>& aColumns, std::mutex& aLock, const TPoint& aCenter, double aRadius, std::vector<uint64_t>& aMask) {
+    BuildColumns(aValues, aColumns, aLock);
+    const double center[] = { aCenter.X(), aCenter.Y(), aCenter.Z() };
+    aMask.resize((aColumns.Size() + 63) / 64);
+    CDoubleKernels::Within(aColumns.X(), aColumns.Y(), aColumns.Z(), aColumns.Size(), center, aRadius, aMask.data());
+    return true;
+}
+
+template <typename TValue>
+static bool ContainsSmall(const CFlatStorage<TValue>&, std::span<const TValue>, uint64_t&) { return false; }
+
+[[maybe_unused]] static bool ContainsSmall(const CFlatStorage<TPackedDouble>& aValues, std::span<const TPackedDouble> aCandidates, uint64_t& aMask) {
+    if (!aValues.Dense() || aValues.Size() > KLinearContains) return false;
+    aMask = CDoubleKernels::Contains(reinterpret_cast<const double*>(aCandidates.data()), aCandidates.size(), reinterpret_cast<const double*>(aValues.Data()), aValues.Size());
+    return true;
+}
+
+// Set operations merge sorted views (ordered indexes) of both sets, which are built on demand and kept until the next modification;
+// on large sets elements are split into chunks by slots and probed in the hash index of the other set by several threads instead
+// (probes only read both sets), selected values are then appended to the result at once, which rebuilds its index in parallel too
+
+static bool Parallel(size_t aCount) { return CParallel::Chunks(aCount, KParallelChunk) > 1; }
+
+template <typename TValue>
+static std::vector<TValue> Select(const CFlatStorage<TValue>& aValues, const CFlatStorage<TValue>& aOther, bool aPresent) {
+    size_t count = aValues.SlotCount(), chunks = CParallel::Chunks(count, KParallelChunk);
+    std::vector<uint8_t> selected(count);
+    std::vector<size_t> offsets(chunks + 1, 0);
+    // every chunk marks its values and counts them, prefix sums of the counts give positions of chunks in the result
+    CParallel::For(chunks, 1, [&](size_t aFirst, size_t aLast) {
+        for (size_t chunk = aFirst; chunk < aLast; ++chunk) {
+            size_t found = 0;
+            for (size_t i = count * chunk / chunks; i < count * (chunk + 1) / chunks; ++i) {
+                selected[i] = aValues.Live(i) && aOther.Contains(aValues.At(i)) == aPresent;
+                found += selected[i];
+            }
+            offsets[chunk + 1] = found;
+        }
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<TValue> result(offsets.back());
+    CParallel::For(chunks, 1, [&](size_t aFirst, size_t aLast) {
+        for (size_t chunk = aFirst; chunk < aLast; ++chunk) {
+            size_t position = offsets[chunk];
+            for (size_t i = count * chunk / chunks; i < count * (chunk + 1) / chunks; ++i) {
+                if (selected[i]) result[position++] = aValues.At(i);
+            }
+        }
+    });
+    return result;
+}
+
+template <typename TValue>
+static bool IncludesAll(const CFlatStorage<TValue>& aValues, const CFlatStorage<TValue>& aOther) {
+    std::atomic<bool> all{ true };
+    CParallel::For(aOther.SlotCount(), KParallelChunk, [&](size_t aBegin, size_t aEnd) {
+        for (size_t i = aBegin; i < aEnd && all.load(std::memory_order_relaxed); ++i) {
+            if (aOther.Live(i) && !aValues.Contains(aOther.At(i))) all.store(false, std::memory_order_relaxed);
+        }
+    });
+    return all.load();
+}
+
+template <typename TElement>
+void CSetT<TElement>::Copy(const CSet& aVal) { //Function for copying sets
+    iValues = aVal.iValues; // storage is shared until one of the sets is modified
+    Settings(aVal);
+}
+
+template <typename TElement>
+void CSetT<TElement>::Settings(const CSet& aVal) { //function for taking over settings of aVal
+    iTolerance.Enable(aVal.iTolerance.Mode(), aVal.iTolerance.Tolerance()); // indexes are built by the first query
+    iGrid.Enable(aVal.iGrid.CellSize());
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::Derived() const { //function for creating empty result of operation
+    CSet result;
+    result.Settings(*this);
+    return result;
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::Derived(const CSet& aVal) const { //function for creating result of operation with values of aVal
+    CSet result = Derived();
+    result.iValues = aVal.iValues;
+    return result;
+}
+
+template <typename TElement>
+void CSetT<TElement>::Destroy() { //function for deallocating sets
+    Invalidate();
+    iValues.Clear();
+}
+
+template <typename TElement>
+void CSetT<TElement>::Materialize() const { //function for building linear list of CEntity nodes from iValues
+    std::lock_guard<std::mutex> lock(iBuildLock);
+    if (iFirst.load(std::memory_order_acquire) != nullptr) return;
+    CEntity* first = nullptr;
+    CEntity* last = nullptr;
+    iNodes.Reserve(iValues.Size());
+    iValues.ForEach([&](const TValue& aValue) {
+        CEntity* temp_node = iNodes.New(aValue, nullptr);
+        if (last) last->SetNextItem(temp_node);
+        else first = temp_node;
+        last = temp_node;
+    });
+    iFirst.store(first, std::memory_order_release);
+}
+
+template <typename TElement>
+void CSetT<TElement>::Invalidate(bool aKeepIndexes) const { //function for dropping views built from iValues
     iFirst = nullptr;
-    while (temp) {
-        next = dynamic_cast<CEntity*>(temp->NextItem());
-        temp->SetNextItem(nullptr);
-        delete temp;
-        temp = next;
-        --iSize;
+    iNodes.Release();
+    iOrdered.Invalidate();
+    iColumns.Invalidate();
+    if (aKeepIndexes) return;
+    iGrid.Invalidate();
+    iTolerance.Invalidate();
+}
+
+template <typename TElement>
+const CSpatialGrid<TElement>* CSetT<TElement>::Grid() const { //function for getting spatial grid
+    if (!iGrid.Enabled()) return nullptr;
+    if (!iGrid.Valid()) {
+        std::lock_guard<std::mutex> lock(iBuildLock);
+        if (!iGrid.Valid()) iGrid.Build(iValues);
+    }
+    return &iGrid;
+}
+
+template <typename TElement>
+const CToleranceIndex<TElement>* CSetT<TElement>::Tolerant() const { //function for getting tolerance index
+    if (!iTolerance.Enabled()) return nullptr;
+    if (!iTolerance.Valid()) {
+        std::lock_guard<std::mutex> lock(iBuildLock);
+        if (!iTolerance.Valid()) iTolerance.Build(iValues);
+    }
+    return &iTolerance;
+}
+
+template <typename TElement>
+const COrderedIndex<TElement>& CSetT<TElement>::Ordered() const { //function for getting ordered index
+    if (!iOrdered.Valid()) {
+        std::lock_guard<std::mutex> lock(iBuildLock);
+        if (!iOrdered.Valid()) iOrdered.Build(iValues);
     }
+    return iOrdered;
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::Collect(size_t aFirst, size_t aLast) const { //function for creating set from range of ordered index
+    CSet result = Derived();
+    if (aFirst >= aLast) return result;
+    std::vector<size_t> slots = iOrdered.Slots(aFirst, aLast);
+    result.iValues.Reserve(slots.size());
+    for (size_t slot : slots) result.iValues.Insert(iValues.At(slot));
+    return result;
+}
+
+template <typename TElement>
+bool CSetT<TElement>::Scan(const TValue* aLow, bool aLowInclusive, const TValue* aHigh, bool aHighInclusive, std::vector<uint64_t>& aMask) const { //function for answering range query by vectorized scan
+    if (iOrdered.Valid() || iOrdered.Request()) return false;
+    return ScanRange(iValues, iColumns, iBuildLock, aLow, aLowInclusive, aHigh, aHighInclusive, aMask);
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::Masked(const std::vector<uint64_t>& aMask) const { //function for creating set from slots selected by bit mask
+    CSet result = Derived();
+    iValues.ForEachSlot([&](size_t aSlot, const TValue& aValue) {
+        if ((aMask[aSlot / 64] >> (aSlot % 64)) & 1) result.iValues.Insert(aValue);
+    });
+    return result;
+}
+
+template <typename TElement>
+std::vector<TElement> CSetT<TElement>::Matching(const CSet& aVal, bool aPresent) const { //function for selecting values by their presence in aVal
+    if (Parallel(iValues.SlotCount())) return Select(iValues, aVal.iValues, aPresent);
+    // sorted views are built by the first operation (or range query) after modification, the next ones merge them without sorting
+    std::vector<bool> common = Ordered().Run().Common(aVal.Ordered().Run());
+    std::vector<TValue> result;
+    iValues.ForEachSlot([&](size_t aSlot, const TValue& aValue) {
+        if (common[aSlot] == aPresent) result.push_back(aValue);
+    });
+    return result;
 }
 
 //C'tors
-CSet::CSet(const char* aStr) : iFirst(nullptr), iSize(0) {
-    std::istringstream iss(aStr, std::istringstream::in);
-    iss >> *this;
+template <typename TElement>
+CSetT<TElement>::CSetT(const char* aStr) : iFirst(nullptr) {
+    parse(aStr, false);
 }
 
-CSet::CSet(size_t aSize) : iFirst(nullptr), iSize(0) {
+template <typename TElement>
+CSetT<TElement>::CSetT(size_t aSize) : iFirst(nullptr) {
     for (size_t i = 0; i < aSize; ++i) {
         this->add(CEntity(CEntity::TestValueRandom()));
-        ++iSize;
     }
 }
 
-CSet::CSet(CEntity* aVal, size_t aSize) : iFirst(nullptr), iSize(0) {
+template <typename TElement>
+CSetT<TElement>::CSetT(CEntity* aVal, size_t aSize) : iFirst(nullptr) {
     size_t i = 0;
     size_t living = ClassInfo<CEntity>::Living();
     while (i < aSize - 1) {
@@ -60,240 +295,420 @@ CSet::CSet(CEntity* aVal, size_t aSize) : iFirst(nullptr), iSize(0) {
 }
 
 //Operators
-CSet& CSet::operator=(const CSet& aVal) {
-    if (this->DeepCompare(aVal)) return *this;
+template <typename TElement>
+CSetT<TElement>& CSetT<TElement>::operator=(const CSet& aVal) {
+    if (this == &aVal) return *this;
     Destroy();
     Copy(aVal);
     return *this;
 }
 
-CSet& CSet::operator-() {
-    CEntity* temp = iFirst;
-    while (temp) {
-        CEntity inv_val = CEntity(-*temp);
-        temp->SetValue(inv_val.Value());
-        temp = dynamic_cast<CEntity*>(temp->NextItem());
-    }
+template <typename TElement>
+CSetT<TElement>& CSetT<TElement>::operator=(CSet&& aVal) noexcept {
+    if (this == &aVal) return *this;
+    Destroy();
+    iValues = std::move(aVal.iValues);
+    iFirst = aVal.iFirst.exchange(nullptr);
+    iNodes = std::move(aVal.iNodes);
+    iOrdered = std::move(aVal.iOrdered);
+    aVal.iOrdered.Invalidate();
+    aVal.iColumns.Invalidate();
+    iGrid = std::move(aVal.iGrid);
+    aVal.iGrid.Invalidate();
+    iTolerance = std::move(aVal.iTolerance);
+    aVal.iTolerance.Invalidate();
     return *this;
 }
 
-CSet CSet::operator -(const CSet& aVal) const {
-    if (this->iFirst == nullptr || aVal.iFirst == nullptr) return *this;
-    CSet difference = CSet(*this);
-    CEntity* temp = aVal.iFirst;
-    while (temp) {
-        if (difference.is_element_of(*temp)) difference.erase(*temp);
-        temp = dynamic_cast<CEntity*>(temp->NextItem());
-    }
+template <typename TElement>
+CSetT<TElement>& CSetT<TElement>::operator-() {
+    Invalidate();
+    if (!NegateValues(iValues)) iValues.Transform([](TValue& aValue) { aValue = -aValue; });
+    return *this;
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::operator -(const CSet& aVal) const & {
+    if (this->is_empty() || aVal.is_empty()) return *this;
+    std::vector<TValue> kept = Matching(aVal, false);
+    CSet difference = Derived();
+    difference.iValues.Append(kept.data(), kept.size());
     return difference;
 }
 
-CSet& CSet::operator +=(const CSet& aVal) {
-    if (aVal.iFirst == nullptr) return *this;
-    CEntity* temp = aVal.iFirst;
-    while (temp) {
-        if (!this->is_element_of(*temp)) this->add(*temp);
-        temp = dynamic_cast<CEntity*>(temp->NextItem());
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::operator -(const CSet& aVal) && {
+    if (!this->is_empty() && !aVal.is_empty()) {
+        Invalidate();
+        if (Parallel(iValues.SlotCount())) {
+            std::vector<TValue> kept = Select(iValues, aVal.iValues, false);
+            iValues.Clear();
+            iValues.Append(kept.data(), kept.size());
+        }
+        else iValues.RemoveIf([&](const TValue& aValue) { return aVal.iValues.Contains(aValue); });
+    }
+    return std::move(*this);
+}
+
+template <typename TElement>
+CSetT<TElement>& CSetT<TElement>::operator +=(const CSet& aVal) {
+    if (aVal.is_empty()) return *this;
+    Invalidate();
+    if (Parallel(aVal.iValues.SlotCount())) {
+        std::vector<TValue> missing = Select(aVal.iValues, iValues, false);
+        if (missing.size() * KRebuildShare >= iValues.Size()) iValues.Append(missing.data(), missing.size());
+        else {
+            // Append() rebuilds index over all slots of the set, which costs more than inserting few missing values
+            iValues.Reserve(iValues.Size() + missing.size());
+            for (const TValue& value : missing) iValues.Insert(value);
+        }
+        return *this;
     }
+    iValues.Reserve(iValues.Size() + aVal.iValues.Size());
+    aVal.iValues.ForEach([&](const TValue& aValue) { iValues.Insert(aValue); });
     return *this;
 }
 
-CSet CSet::operator+(const CSet& aVal) const {
-    if (aVal.iFirst == nullptr) return *this;
-    if (this->iFirst == nullptr) return aVal;
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::operator+(const CSet& aVal) const & {
+    if (aVal.is_empty()) return *this;
+    if (this->is_empty()) return Derived(aVal);
     CSet sum = CSet(*this);
-    CEntity* temp = aVal.iFirst;
-    while (temp) {
-        if (!sum.is_element_of(*temp)) sum.add(*temp);
-        temp = dynamic_cast<CEntity*>(temp->NextItem());
-    }
+    sum += aVal;
     return sum;
 }
 
-CSet operator + (const CSet& aSet, const CEntity& aVal) {
-    CSet emp = CSet(aSet);
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::operator+(const CSet& aVal) && {
+    *this += aVal;
+    return std::move(*this);
+}
+
+template <typename TElement>
+CSetT<TElement> operator + (const CSetT<TElement>& aSet, const typename TSetTraits<TElement>::TEntity& aVal) {
+    CSetT<TElement> emp = CSetT<TElement>(aSet);
     emp.add(aVal);
     return emp;
 }
 
-std::istream& operator >>(std::istream& aIStream, CSet& aValue) {
-    char ch = '\0';
-    std::string temp_str;
-    CEntity temp_ent;
+template <typename TElement>
+CSetT<TElement> operator + (CSetT<TElement>&& aSet, const typename TSetTraits<TElement>::TEntity& aVal) {
+    aSet.add(aVal);
+    return std::move(aSet);
+}
+
+template <typename TElement>
+std::istream& operator >>(std::istream& aIStream, CSetT<TElement>& aValue) {
     if (!aIStream.good())
         throw std::runtime_error("Input stream data integrity error!");
-    while (!aIStream.eof()) {
-        aIStream >> std::noskipws >> ch;
-        if (ch == '[' && ch != ',') {
-            aIStream >> ch;
-            while (ch != ']') {
-                if (ch != ';') {
-                    temp_str.push_back(ch);
-                }
-                else {
-                    temp_str.push_back(' ');
-                }
-                aIStream >> ch;
-            }
-            temp_ent = CEntity(temp_str);
-            if (aValue.iFirst == nullptr) aValue = CSet(temp_ent);
-            else aValue.add(temp_ent);
-        }
-        temp_str = "";
-    }
+    std::string text((std::istreambuf_iterator<char>(aIStream)), std::istreambuf_iterator<char>());
+    aIStream.setstate(std::ios_base::eofbit);
+    aValue.parse(text, false);
     return aIStream;
 }
 
-std::ostream& operator <<(std::ostream& aOStream, const CSet& aValue) {
-    if (aValue.iFirst == nullptr) {
+template <typename TElement>
+size_t CSetT<TElement>::parse(std::string_view aText, bool aStrict) {
+    std::vector<TValue> values;
+    size_t end = ScanSetText<TValue>(aText, aStrict, [&](const TValue& aValue) { values.push_back(aValue); });
+    if (aStrict && end != aText.size()) throw std::invalid_argument("Unterminated set element at offset " + std::to_string(end));
+    size_t before = num_of_elements();
+    Invalidate();
+    iValues.Reserve(before + values.size());
+    for (const TValue& value : values) iValues.Insert(value);
+    return num_of_elements() - before;
+}
+
+template <typename TElement>
+std::ostream& operator <<(std::ostream& aOStream, const CSetT<TElement>& aValue) {
+    if (aValue.is_empty()) {
         aOStream << "";
         return aOStream;
     }
-    CEntity* temp = aValue.iFirst;
-    while (temp) {
-        aOStream << '[' << temp->Value() << ']';
-        if (temp->NextItem()) aOStream << ',';
-        temp = dynamic_cast<CEntity*>(temp->NextItem());
+    const std::ios_base::fmtflags number_flags = std::ios_base::floatfield | std::ios_base::showpos | std::ios_base::showpoint | std::ios_base::uppercase;
+    if ((aOStream.flags() & number_flags) == 0 && aOStream.precision() == 6 && aOStream.width() == 0 && aOStream.getloc() == std::locale::classic()) {
+        std::string buffer;
+        aValue.format_to(buffer);
+        aOStream.write(buffer.data(), std::streamsize(buffer.size()));
+        return aOStream;
     }
+    bool first = true;
+    aValue.iValues.ForEach([&](const TElement& aVal) {
+        if (!first) aOStream << ',';
+        aOStream << '[' << aVal << ']';
+        first = false;
+    });
     return aOStream;
 }
 
+template <typename TElement>
+void CSetT<TElement>::format_to(std::string& aBuffer, int aPrecision) const {
+    size_t used = aBuffer.size();
+    bool first = true;
+    for (const TValue& value : iValues) {
+        if (aBuffer.size() - used < TValue::KCharsMax + 3) {
+            aBuffer.resize(std::max(aBuffer.size() * 2, used + 4096));
+        }
+        char* out = aBuffer.data() + used;
+        if (!first) *out++ = ',';
+        *out++ = '[';
+        // ToChars() clamps precision, so KCharsMax is enough for any value, ']' still needs its own check
+        out = value.ToChars(out, aBuffer.data() + aBuffer.size() - 1, aPrecision);
+        if (out == nullptr) throw std::runtime_error("CSet::format_to: formatted value does not fit into KCharsMax characters");
+        *out++ = ']';
+        used = out - aBuffer.data();
+        first = false;
+    }
+    aBuffer.resize(used);
+}
+
 //Methods
-bool CSet::is_subset_of(const CSet& aVal) const {
-    if (iSize < aVal.iSize) return false;
-    if (iSize == aVal.iSize) {
+template <typename TElement>
+bool CSetT<TElement>::is_subset_of(const CSet& aVal) const {
+    if (num_of_elements() < aVal.num_of_elements()) return false;
+    if (num_of_elements() == aVal.num_of_elements()) {
         if (this->DeepCompare(aVal)) return true;
         return false;
     }
-    CEntity* sub_current = aVal.iFirst;
-    while (sub_current) {
-        CEntity* this_current = iFirst;
-        bool is_member = false;
-        while (this_current) {
-            if (sub_current->Value() == this_current->Value()) {
-                is_member = true;
-                break;
-            }
-            this_current = dynamic_cast<CEntity*>(this_current->NextItem());
-        }
-        if (!is_member) return false;
-        sub_current = dynamic_cast<CEntity*>(sub_current->NextItem());
-    }
-    return true;
+    if (Parallel(aVal.iValues.SlotCount())) return IncludesAll(iValues, aVal.iValues);
+    // ordered index leaves out NaN values, which are never included in another set
+    return aVal.Ordered().Size() == aVal.num_of_elements() && Ordered().Run().Includes(aVal.Ordered().Run());
 }
 
-CSet CSet::intersection(const CSet& aVal) const {
-    if (this->iFirst == nullptr) return *this;
-    if (aVal.iFirst == nullptr) return aVal;
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::intersection(const CSet& aVal) const & {
+    if (this->is_empty()) return *this;
+    if (aVal.is_empty()) return Derived(aVal);
     if (this->DeepCompare(aVal)) return *this;
-    CSet intersect = CSet();
-    CEntity* this_curr = iFirst;
-    while (this_curr) {
-        CEntity* aVal_curr = aVal.iFirst;
-        while (aVal_curr) {
-            if (this_curr->Value() == aVal_curr->Value()) {
-                intersect.add(*aVal_curr);
-                break;
-            }
-            aVal_curr = dynamic_cast<CEntity*>(aVal_curr->NextItem());
-        }
-        this_curr = dynamic_cast<CEntity*>(this_curr->NextItem());
-    }
+    std::vector<TValue> common = Matching(aVal, true);
+    CSet intersect = Derived();
+    intersect.iValues.Append(common.data(), common.size());
     return intersect;
 }
 
-bool CSet::are_same(const CSet& aVal) const {
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::intersection(const CSet& aVal) && {
+    Invalidate();
+    if (Parallel(iValues.SlotCount())) {
+        std::vector<TValue> common = Select(iValues, aVal.iValues, true);
+        iValues.Clear();
+        iValues.Append(common.data(), common.size());
+    }
+    else iValues.RemoveIf([&](const TValue& aValue) { return !aVal.iValues.Contains(aValue); });
+    return std::move(*this);
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::symmetric_difference(const CSet& aVal) const {
+    if (this->is_empty()) return Derived(aVal);
+    if (aVal.is_empty()) return *this;
+    std::vector<TValue> difference = Matching(aVal, false), other = aVal.Matching(*this, false);
+    difference.insert(difference.end(), other.begin(), other.end());
+    CSet result = Derived();
+    result.iValues.Append(difference.data(), difference.size());
+    return result;
+}
+
+template <typename TElement>
+bool CSetT<TElement>::are_same(const CSet& aVal) const {
     return this->DeepCompare(aVal);
 }
 
-bool CSet::DeepCompare(const CSet& aVal) const {
-    if (aVal.iSize != this->iSize) return false;
-    CEntity* aVal_curr = aVal.iFirst;
-    while (aVal_curr) {
-        if (!this->is_element_of(*aVal_curr)) return false;
-        aVal_curr = dynamic_cast<CEntity*>(aVal_curr->NextItem());
-    }
-    return true;
+template <typename TElement>
+bool CSetT<TElement>::DeepCompare(const CSet& aVal) const {
+    if (aVal.num_of_elements() != this->num_of_elements()) return false;
+    if (Parallel(aVal.iValues.SlotCount())) return IncludesAll(iValues, aVal.iValues);
+    bool same = true;
+    aVal.iValues.ForEach([&](const TValue& aValue) {
+        if (same && !iValues.Contains(aValue)) same = false;
+    });
+    return same;
 }
 
-CSet CSet::complement(const CSet& aVal) const {
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::complement(const CSet& aVal) const & {
 	if (aVal.is_empty()) return *this;
 	CSet comp = CSet(*this - aVal);
 	return comp;
 }
 
-CSet CSet::section_smaller(const CEntity& aVal) const {
-	if (iSize == 0) return *this;
-	CSet smaller;
-	CEntity* temp = iFirst;
-	while (temp) {
-		if (aVal.Value() > temp->Value()) smaller.add(*temp);
-		temp = dynamic_cast<CEntity*>(temp->NextItem());
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::complement(const CSet& aVal) && {
+	return std::move(*this) - aVal;
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::section_smaller(const CEntity& aVal) const {
+	if (is_empty()) return *this;
+	TValue high = aVal.Value();
+	std::vector<uint64_t> mask;
+	if (Scan(nullptr, false, &high, false, mask)) return Masked(mask);
+	return Collect(0, Ordered().Upper(high, false));
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::section_larger(const CEntity& aVal) const {
+	if (is_empty()) return *this;
+	TValue low = aVal.Value();
+	std::vector<uint64_t> mask;
+	if (Scan(&low, false, nullptr, false, mask)) return Masked(mask);
+	const COrderedIndex<TValue>& ordered = Ordered();
+	return Collect(ordered.Lower(low, false), ordered.Size());
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::section(const CEntity& aLow, const CEntity& aHigh, bool aLowInclusive, bool aHighInclusive) const {
+	if (is_empty()) return *this;
+	TValue low = aLow.Value(), high = aHigh.Value();
+	std::vector<uint64_t> mask;
+	if (Scan(&low, aLowInclusive, &high, aHighInclusive, mask)) return Masked(mask);
+	const COrderedIndex<TValue>& ordered = Ordered();
+	return Collect(ordered.Lower(low, aLowInclusive), ordered.Upper(high, aHighInclusive));
+}
+
+template <typename TElement>
+size_t CSetT<TElement>::count_in_range(const CEntity& aLow, const CEntity& aHigh, bool aLowInclusive, bool aHighInclusive) const {
+	if (is_empty()) return 0;
+	TValue low = aLow.Value(), high = aHigh.Value();
+	std::vector<uint64_t> mask;
+	if (Scan(&low, aLowInclusive, &high, aHighInclusive, mask)) {
+		size_t count = 0;
+		if (iValues.Dense()) {
+			for (uint64_t word : mask) count += size_t(std::popcount(word));
+		}
+		else iValues.ForEachSlot([&](size_t aSlot, const TValue&) { count += (mask[aSlot / 64] >> (aSlot % 64)) & 1; });
+		return count;
 	}
-	return smaller;
+	const COrderedIndex<TValue>& ordered = Ordered();
+	size_t first = ordered.Lower(low, aLowInclusive), last = ordered.Upper(high, aHighInclusive);
+	return (first < last) ? last - first : 0;
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::within(const CEntity& aCenter, double aRadius) const {
+	if (!(aRadius >= 0)) throw std::invalid_argument("Radius has to be not negative number!");
+	TValue center = aCenter.Value();
+	std::vector<uint64_t> mask;
+	if (ScanWithin(iValues, iColumns, iBuildLock, center, aRadius, mask)) return Masked(mask);
+	CSet result = Derived();
+	iValues.ForEach([&](const TValue& aValue) {
+		if (aValue.IsWithin(center, aRadius)) result.iValues.Insert(aValue);
+	});
+	return result;
+}
+
+template <typename TElement>
+void CSetT<TElement>::spatial_index(double aCellSize) {
+	if (!(aCellSize >= 0) || std::isinf(aCellSize)) throw std::invalid_argument("Cell size of spatial index has to be finite and not negative!");
+	iGrid.Enable(aCellSize);
 }
 
-CSet CSet::section_larger(const CEntity& aVal) const {
-	if (iSize == 0) return *this;
-	CSet larger;
-	CEntity* temp = iFirst;
-	while (temp) {
-		if (aVal.Value() < temp->Value()) larger.add(*temp);
-		temp = dynamic_cast<CEntity*>(temp->NextItem());
+template <typename TElement>
+typename CSetT<TElement>::CEntity CSetT<TElement>::nearest(const CEntity& aPoint) const {
+	if (is_empty()) throw std::runtime_error("Nearest element of empty set does not exist!");
+	CSet found = nearest(aPoint, 1);
+	return CEntity(*found.begin());
+}
+
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::nearest(const CEntity& aPoint, size_t aCount) const {
+	using TRanked = CSpatialGrid<TValue>::TRanked;
+	TValue point = aPoint.Value();
+	CSet result = Derived();
+	if (const CSpatialGrid<TValue>* grid = Grid()) {
+		for (const TValue& value : grid->Nearest(point, aCount)) result.iValues.Insert(value);
+		return result;
 	}
-	return larger;
+	std::vector<TRanked> ranked;
+	ranked.reserve(iValues.Size());
+	iValues.ForEach([&](const TValue& aValue) { ranked.push_back(CSpatialGrid<TValue>::Rank(point, aValue)); });
+	size_t count = std::min(aCount, ranked.size());
+	std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), CSpatialGrid<TValue>::Closer);
+	for (size_t i = 0; i < count; ++i) result.iValues.Insert(ranked[i].second);
+	return result;
 }
 
-void CSet::add(const CEntity& aVal) {
-    if (!this->is_element_of(aVal)) {
-        CEntity* temp_node = new CEntity(aVal);
-        if (iFirst == nullptr) {
-            iFirst = temp_node;
-        }
-        else {
-            CEntity* temp_first = iFirst;
-            while (temp_first->NextItem()) temp_first = dynamic_cast<CEntity*>(temp_first->NextItem());
-            temp_first->SetNextItem(temp_node);
-            temp_first = dynamic_cast<CEntity*>(temp_first->NextItem());
-        }
-        iSize++;
-    }
+template <typename TElement>
+CSetT<TElement> CSetT<TElement>::box(const CEntity& aLow, const CEntity& aHigh) const {
+	TValue low = aLow.Value(), high = aHigh.Value();
+	CSet result = Derived();
+	if (const CSpatialGrid<TValue>* grid = Grid()) {
+		std::vector<TValue> found = grid->Box(low, high);
+		std::vector<size_t> slots;
+		slots.reserve(found.size());
+		for (const TValue& value : found) slots.push_back(iValues.Slot(value));
+		std::sort(slots.begin(), slots.end());
+		result.iValues.Reserve(slots.size());
+		for (size_t slot : slots) result.iValues.Insert(iValues.At(slot));
+		return result;
+	}
+	iValues.ForEach([&](const TValue& aValue) {
+		for (size_t axis = 0; axis < 3; ++axis) {
+			if (!(low.Coordinate(axis) <= aValue.Coordinate(axis) && aValue.Coordinate(axis) <= high.Coordinate(axis))) return;
+		}
+		result.iValues.Insert(aValue);
+	});
+	return result;
 }
 
-void CSet::erase(const CEntity& aVal) {
-    if (this->is_element_of(aVal)) {
-        CEntity* temp = iFirst;
-        CEntity* prev = temp;
-        while (temp->Value() != aVal.Value()) {
-            prev = temp;
-            temp = dynamic_cast<CEntity*>(temp->NextItem());
-        }
-        if (temp == iFirst) {
-            iFirst = dynamic_cast<CEntity*>(iFirst->NextItem());
-        }
-        else {
-            prev->SetNextItem(temp->NextItem());
-        }
-        temp->SetNextItem(nullptr);
-        delete(temp);
-        iSize--;
-    }
+template <typename TElement>
+uint64_t CSetT<TElement>::contains_many(std::span<const TValue> aValues) const {
+	if (aValues.size() > 64) throw std::invalid_argument("At most 64 values can be checked at once!");
+	uint64_t mask = 0;
+	if (const CToleranceIndex<TValue>* tolerant = Tolerant()) {
+		for (size_t i = 0; i < aValues.size(); ++i) {
+			if (tolerant->Contains(aValues[i])) mask |= uint64_t(1) << i;
+		}
+		return mask;
+	}
+	if (ContainsSmall(iValues, aValues, mask)) return mask;
+	for (size_t i = 0; i < aValues.size(); ++i) {
+		if (iValues.Contains(aValues[i])) mask |= uint64_t(1) << i;
+	}
+	return mask;
+}
+
+template <typename TElement>
+void CSetT<TElement>::tolerance(TToleranceMode aMode, double aTolerance) {
+	if (!(aTolerance >= 0) || std::isinf(aTolerance)) throw std::invalid_argument("Tolerance has to be finite and not negative!");
+	iTolerance.Enable(aMode, aTolerance);
+}
+
+template <typename TElement>
+void CSetT<TElement>::add(const CEntity& aVal) {
+    TValue value = aVal.Value();
+    const CToleranceIndex<TValue>* tolerant = Tolerant();
+    if (tolerant ? tolerant->Contains(value) : iValues.Contains(value)) return;
+    Invalidate(true);
+    if (!iValues.Insert(value)) return;
+    if (iGrid.Valid()) iGrid.Insert(value);
+    if (iTolerance.Valid()) iTolerance.Insert(value);
 }
 
-CSet& CSet::Reverse() {
-    CEntity* curr = iFirst;
-    CEntity* prev = nullptr, * next = nullptr;
-    while (curr != nullptr) {
-        next = dynamic_cast<CEntity*>(curr->NextItem());
-        curr->SetNextItem(prev);
-        prev = curr;
-        curr = next;
+template <typename TElement>
+void CSetT<TElement>::erase(const CEntity& aVal) {
+    TValue value = aVal.Value();
+    std::vector<TValue> matches;
+    if (const CToleranceIndex<TValue>* tolerant = Tolerant()) tolerant->ForEachMatch(value, [&](const TValue& aMatch) { matches.push_back(aMatch); return true; });
+    else if (iValues.Contains(value)) matches.push_back(value);
+    if (matches.empty()) return;
+    Invalidate(true);
+    for (const TValue& match : matches) {
+        iValues.Erase(match);
+        if (iGrid.Valid()) iGrid.Erase(match);
+        if (iTolerance.Valid()) iTolerance.Erase(match);
     }
-    iFirst = prev;
+}
+
+template <typename TElement>
+CSetT<TElement>& CSetT<TElement>::Reverse() {
+    Invalidate();
+    iValues.Reverse();
     return *this;
 }
 
-double CSet::usage() const {
+template <typename TElement>
+double CSetT<TElement>::usage() const {
     size_t set_size = sizeof(*this);
     size_t num = this->num_of_elements();
     CEntity* list = new CEntity[num];
@@ -303,26 +718,50 @@ double CSet::usage() const {
     return efect;
 }
 
-CSet Reverse(const CSet& aVal) {
-    CSet reversed = CSet(aVal);
-    return reversed.Reverse();
+template <typename TElement>
+CSetT<TElement> Reverse(const CSetT<TElement>& aVal) {
+    CSetT<TElement> reversed = CSetT<TElement>(aVal);
+    return std::move(reversed.Reverse());
 }
 
-bool CSet::is_element_of(const CEntity& aVal) const {
-    CEntity* temp = iFirst;
-    while (temp) {
-        if (temp->Value() == aVal.Value()) return true;
-        temp = dynamic_cast<CEntity*>(temp->NextItem());
-    }
-    return false;
+template <typename TElement>
+CSetT<TElement> Reverse(CSetT<TElement>&& aVal) {
+    return std::move(aVal.Reverse());
+}
+
+template <typename TElement>
+bool CSetT<TElement>::is_element_of(const CEntity& aVal) const {
+    if (const CToleranceIndex<TValue>* tolerant = Tolerant()) return tolerant->Contains(aVal.Value());
+    return iValues.Contains(aVal.Value());
 }
 
-int CSet::Compare(const CSet& aVal) const {
-    if (iSize == aVal.iSize) return 0;
-    if (iSize < aVal.iSize) return -1;
+template <typename TElement>
+int CSetT<TElement>::Compare(const CSet& aVal) const {
+    if (num_of_elements() == aVal.num_of_elements()) return 0;
+    if (num_of_elements() < aVal.num_of_elements()) return -1;
     return 1;
 }
 
-CEntity* CSet::first_elem() const {
-    return iFirst;
-}
\ No newline at end of file
+template <typename TElement>
+typename CSetT<TElement>::CEntity* CSetT<TElement>::first_elem() const {
+    if (iFirst.load(std::memory_order_acquire) == nullptr && !is_empty()) Materialize();
+    return iFirst.load(std::memory_order_acquire);
+}
+
+// Explicit instantiations for supported value types (see TSetTraits)
+
+template class CSetT<TPackedDouble>;
+template class CSetT<TPoint>;
+
+template std::istream& operator >>(std::istream& aIStream, CSetT<TPackedDouble>& aValue);
+template std::istream& operator >>(std::istream& aIStream, CSetT<TPoint>& aValue);
+template std::ostream& operator <<(std::ostream& aOStream, const CSetT<TPackedDouble>& aValue);
+template std::ostream& operator <<(std::ostream& aOStream, const CSetT<TPoint>& aValue);
+template CSetT<TPackedDouble> operator + (const CSetT<TPackedDouble>& aSet, const CEntity_CDouble::CEntity& aVal);
+template CSetT<TPoint> operator + (const CSetT<TPoint>& aSet, const CEntity_TPoint::CEntity& aVal);
+template CSetT<TPackedDouble> operator + (CSetT<TPackedDouble>&& aSet, const CEntity_CDouble::CEntity& aVal);
+template CSetT<TPoint> operator + (CSetT<TPoint>&& aSet, const CEntity_TPoint::CEntity& aVal);
+template CSetT<TPackedDouble> Reverse(const CSetT<TPackedDouble>& aVal);
+template CSetT<TPoint> Reverse(const CSetT<TPoint>& aVal);
+template CSetT<TPackedDouble> Reverse(CSetT<TPackedDouble>&& aVal);
+template CSetT<TPoint> Reverse(CSetT<TPoint>&& aVal);
\ No newline at end of file
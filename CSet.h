@@ -7,60 +7,134 @@
 *  Authors: Martin Bezecn
 */
 
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <utility>		// Due to: std::declval<CEntity>
+
 #include "CEntity.h"
+#include "CSetTraits.h"
+#include "CFlatStorage.h"
+#include "CNodeArena.h"
+#include "COrderedIndex.h"
+#include "CPointColumns.h"
+#include "CSpatialGrid.h"
+#include "CToleranceIndex.h"
+#include "CSetAlgebra.h"
+#include "CSetText.h"
 #include "check.h"
 
 
 /*
- * CSet class
- * Definition of CSet class. There are defined all common methods and attributes.
+ * CSetT class
+ * Definition of CSet class template. There are defined all common methods and attributes.
+ * Element type is template parameter (CDouble or TPoint, see TSetTraits), so sets of both types can be used in one program;
+ * member functions are defined in CSet.cpp and instantiated there for both supported types.
+ * Const methods of one set can be called from several threads at once: views, which they build on demand (linear list, ordered index, columns,
+ * spatial grid, tolerance index), are built under iBuildLock and published by atomic valid flags (see CValidFlag).
+ * Sets returned by operations and queries inherit settings of the left operand (the set, whose method or operator is called) in all cases.
  */
-class CSet
+template <typename TElement>
+class CSetT
 	{
+public:
+    using CSet = CSetT; ///< The set type itself (this specialization)
+    using CEntity = typename TSetTraits<TElement>::TEntity; ///< Node class of the set (CEntity variant encapsulating TValue)
+    using TValue = TElement; ///< Type of stored values (CDouble or TPoint)
+    static_assert(TSetTraits<TValue>::KHashed && TSetTraits<TValue>::KOrdered && TSetTraits<TValue>::KParsed && TSetTraits<TValue>::KSpatial, "Set value has to provide Hash(), Order(), FromChars(), ToChars() and Coordinate()");
+    static_assert(TSetTraits<TValue>::KFlat, "Set value has to be trivially copyable");
+    using value_type = TValue; ///< Type of iterated values
+    using const_iterator = CFlatStorage<TValue>::const_iterator; ///< Forward iterator over values in insertion order
+    using iterator = const_iterator; ///< Values of the set can not be modified through iterator
 
+private:
     ClassInfo <CSet> iInstanceInfo; ///< Instance of the class info for usage statistics
-    CEntity* iFirst = nullptr; ///< Location of first node
-    size_t iSize = 0; ///< Number of elements in CSet
+    CFlatStorage<TValue> iValues; ///< Values of elements in insertion order
+    mutable std::atomic<CEntity*> iFirst = nullptr; ///< Location of first node of linear list, which is materialized on demand from iValues (published after the whole list is built)
+    mutable CNodeArena<CEntity> iNodes; ///< Slabs holding nodes of materialized linear list
+    mutable COrderedIndex<TValue> iOrdered; ///< Sorted index for range queries and set operations, which is built on demand from iValues
+    mutable CPointColumns<TValue> iColumns; ///< Columns of point coordinates for vectorized spatial queries (TPoint only), which are built on demand from iValues
+    mutable CSpatialGrid<TValue> iGrid; ///< Optional grid for nearest neighbour and box queries, which is kept up to date by add() and erase()
+    mutable CToleranceIndex<TValue> iTolerance; ///< Optional index for matching elements with tolerance, which is kept up to date by add() and erase()
+    mutable std::mutex iBuildLock; ///< Lock of building views on demand, so const methods can be called from several threads at once
 
     void Copy(const CSet& aVal);//Function for copying sets
 
+    void Settings(const CSet& aVal); //function for taking over settings of aVal (tolerance mode and cell size of spatial grid)
+
+    CSet Derived() const; //function for creating empty result of operation, results inherit settings of the left operand (this set)
+
+    CSet Derived(const CSet& aVal) const; //function for creating result of operation with values of aVal and settings of this set
+
 
     void Destroy(); //function for deallocating sets
 
+    void Materialize() const; //function for building linear list of CEntity nodes from iValues
+
+    void Invalidate(bool aKeepIndexes = false) const; //function for dropping views built from iValues (materialized linear list, ordered index, columns, grid, tolerance index), has to be called by every modification, add() and erase() keep indexes, which they update
+
+    const CSpatialGrid<TValue>* Grid() const; //function for getting spatial grid (built on demand), nullptr when the grid is not enabled
+
+    const CToleranceIndex<TValue>* Tolerant() const; //function for getting tolerance index (built on demand), nullptr when elements are matched exactly
+
+    const COrderedIndex<TValue>& Ordered() const; //function for getting ordered index, which is built by the first range query after modification
+
+    CSet Collect(size_t aFirst, size_t aLast) const; //function for creating set from range of ordered index
+
+    bool Scan(const TValue* aLow, bool aLowInclusive, const TValue* aHigh, bool aHighInclusive, std::vector<uint64_t>& aMask) const; //function for answering range query by vectorized scan of values, when the ordered index is not built
+
+    CSet Masked(const std::vector<uint64_t>& aMask) const; //function for creating set from slots selected by bit mask
+
+    std::vector<TValue> Matching(const CSet& aVal, bool aPresent) const; //function for selecting values, which are (aPresent) or are not included in aVal, in insertion order
+
+    template <typename TType> friend class CSetFileT; //binary file of the set fills values directly
+    template <typename TType> friend class CSetBuilderT; //incremental builder fills values directly
+    template <typename TType> friend struct TSetRef; //lazy expressions read values directly
+    template <typename TNode> friend class CSetExpr; //lazy expressions fill result values directly
+
 public:
         /* 
         * Method: Implicit c'tor
-        * Details: iFirst is set to nullptr, iSize is set to 0
+        * Details: set is empty, iFirst is set to nullptr
         */
-        CSet() : iInstanceInfo(), iFirst(nullptr), iSize(0) {}; //implicit constructor
+        CSetT() : iInstanceInfo(), iValues(), iFirst(nullptr) {}; //implicit constructor
 
         /*
         * Method: Copy c'tor
-        * Details:Create new instance by copying iFirst and iSize Parameters:
+        * Details:Create new instance by copying values of the original, linear list is not copied
         * Parameters: aVal	Original instance for copying
         */
-        CSet(const CSet& aVal) : iFirst(nullptr), iSize(0) { Copy(aVal); }; // copy constructor
+        CSetT(const CSet& aVal) : iFirst(nullptr) { Copy(aVal); }; // copy constructor
+
+        /*
+        * Method: Move c'tor
+        * Details: Create new instance by taking over values and linear list of the original, original set is left empty
+        * Parameters: aVal	Original instance for moving
+        */
+        CSetT(CSet&& aVal) noexcept : iValues(std::move(aVal.iValues)), iFirst(aVal.iFirst.exchange(nullptr)), iNodes(std::move(aVal.iNodes)), iOrdered(std::move(aVal.iOrdered)), iGrid(std::move(aVal.iGrid)), iTolerance(std::move(aVal.iTolerance)) { aVal.iOrdered.Invalidate(); aVal.iColumns.Invalidate(); aVal.iGrid.Invalidate(); aVal.iTolerance.Invalidate(); }; // move constructor
 
 		/*
         * Method: Conversion c'tor from CEntity
-		* Details:creating CSet with one element aVal, iFirst is set to aVal, iSize is set to 1
+		* Details:creating CSet with one element aVal
 		* Parameters: aVal  is  CEntity Value
 		*/
-		CSet(CEntity& aVal) : iFirst(new CEntity(aVal)), iSize(1) { iFirst->SetNextItem(nullptr); } // constructor, creating CSet with one element aVal
+		CSetT(CEntity& aVal) : iFirst(nullptr) { iValues.Insert(aVal.Value()); } // constructor, creating CSet with one element aVal
 		
         /*
         * Method: Conversion c'tor from string
 		* Details: creating CSet from string
 	    * Parameters: aStr  is char string of CEntity values in [ ] and they are separated by ,
 		*/
-		CSet(const char* aStr);//constructor from C string
+		CSetT(const char* aStr);//constructor from C string
 
         /*
         * Method: Conversion c'tor from size_t
         * Details: creating random instances of CEntity and creating CSet of aSize instances
         * Parameters:	aSize that is number of elements in Set
         */
-        CSet(size_t aSize);// constructor size_t, generating random instances of CEntity and creating CSet of aSize instances
+        CSetT(size_t aSize);// constructor size_t, generating random instances of CEntity and creating CSet of aSize instances
 
         /*
         * Method: Conversion c'tor from array of CEntity values and number of elements of CSet
@@ -68,7 +142,7 @@ public:
         * If the array aVal does not contain sufficient number of elements, to the required amount aSize the set is completed with random unique values.
         * Parameters:	aVal is CEntity value, aSize is the number of elements to be added to the set
         */
-        CSet(CEntity* aVal, size_t aSize);
+        CSetT(CEntity* aVal, size_t aSize);
 
         /*
         * Method: Virtual D'tors
@@ -76,7 +150,7 @@ public:
         * It removes dynamic member elements and gradually sets the pointers of the elements in the linear list hidden under the set to nullptr.
         */
 
-        ~CSet() { Destroy(); } //d'tor
+        ~CSetT() { Destroy(); } //d'tor
 
         /*
         * Method: Assigment operator
@@ -86,13 +160,21 @@ public:
         */
         CSet& operator=(const CSet& aVal);
 
+        /*
+        * Method: Move assigment operator
+        * Details: operator taking over the values of the original (except for the iID, which will keep the original), original set is left empty.
+        * Parameters:: aVal is rvalue reference CSet
+        * Return: Overwrite the original values in the resulting variable, without copying
+        */
+        CSet& operator=(CSet&& aVal) noexcept;
+
         /*
         * Method: Comparing by Value operator
         * Details: compares card powers of Sets
         * Parameters: aVal is constant reference CSet
         * Return: Return  bool result of comparation of card powers, if they match, it returns true, otherwise it returns false
         */
-        bool operator == (const CSet& aVal) const { return iSize == aVal.iSize; };
+        bool operator == (const CSet& aVal) const { return num_of_elements() == aVal.num_of_elements(); };
 
         /*
         * Method: Inequality operator
@@ -107,7 +189,18 @@ public:
         * Parameters: aIStream is input stream and aValue is a CSet
         * Return: Returns  stream without the elements loaded into the CSet
         */
-        friend std::istream& operator >>(std::istream& aIStream, CSet& aValue);
+        template <typename TType>
+        friend std::istream& operator >>(std::istream& aIStream, CSetT<TType>& aValue);
+
+        /*
+        * Method: Parse
+        * Details: adds elements from text in the same format as the input operator ("[v],[v],...", TPoint coordinates separated by ; or spaces).
+        * The text is scanned in place and numbers are parsed by std::from_chars, already included values are skipped through the hash index.
+        * Parameters: aText is parsed text, aStrict selects error mode: true throws std::invalid_argument with offset of the first malformed
+        * or unterminated element (the set is not changed then), false skips malformed elements
+        * Return: number of added elements
+        */
+        size_t parse(std::string_view aText, bool aStrict = true);
 
         /*
         * Method: friend output operator
@@ -115,7 +208,16 @@ public:
         * Parameters: aOStream is output stream, aValue is given set
         * Return: Return  output stream with formatted elements from CSet
         */
-        friend std::ostream& operator <<(std::ostream& aOStream, const CSet& aValue);
+        template <typename TType>
+        friend std::ostream& operator <<(std::ostream& aOStream, const CSetT<TType>& aValue);
+
+        /*
+        * Method: Format to buffer
+        * Details: appends elements formatted by std::to_chars in "[v],[v],..." format to the buffer, the text is written without iostream layer.
+        * With default precision the text is the same as the one of the output operator with default stream flags.
+        * Parameters: aBuffer is output buffer, aPrecision is number of significant digits (at most 17, larger precision is clamped; negative value selects the shortest text, which is parsed back to the same values)
+        */
+        void format_to(std::string& aBuffer, int aPrecision = 6) const;
 
 		/*
         * Method: Unary operator minus
@@ -145,7 +247,15 @@ public:
         * Parameters: aVal is constant reference CSet
         *  Return: new set with all elements of the first set that were not included in the second 
         */
-        CSet operator - (const CSet& aVal) const;
+        CSet operator - (const CSet& aVal) const &;
+
+        /*
+        * Method: Binary operator minus (temporary set)
+        * Details: makes the difference of containers directly in the storage of the temporary first set
+        * Parameters: aVal is constant reference CSet
+        *  Return: the first set without elements included in the second
+        */
+        CSet operator - (const CSet& aVal) &&;
 
         /*
         * Method: Binary operator plus equal
@@ -168,7 +278,7 @@ public:
         * Details: converts set to size_t
         * Return: number of elements in set
         */
-        operator size_t() const { return iSize; }
+        operator size_t() const { return num_of_elements(); }
 
         /*
         * Method: Binary operator plus
@@ -176,7 +286,15 @@ public:
         * Parameters: aVal is constant reference CSet
         * Return:  new set with all unique elements of both sets
         */
-        CSet operator + (const CSet& aVal) const;
+        CSet operator + (const CSet& aVal) const &;
+
+        /*
+        * Method: Binary operator plus (temporary set)
+        * Details: it makes union of two sets directly in the storage of the temporary first set, so chained a + b + c copies only once
+        * Parameters: aVal is constant reference CSet
+        * Return:  the first set extended by all unique elements of the second
+        */
+        CSet operator + (const CSet& aVal) &&;
 
         /*
         * Method: Relational operator smaller equal
@@ -192,7 +310,17 @@ public:
         * Parameters: aVal is constant reference CEntity
         * Return:  new set with one added element of CEntity, if the elemnt was not already included in the set
         */
-        friend CSet operator + (const CSet& aSet, const CEntity& aVal);
+        template <typename TType>
+        friend CSetT<TType> operator + (const CSetT<TType>& aSet, const typename TSetTraits<TType>::TEntity& aVal);
+
+        /*
+        * Method: Non-member operator plus (temporary set)
+        * Details: it adds CEntity value directly into the temporary set
+        * Parameters: aSet is rvalue reference CSet, aVal is constant reference CEntity
+        * Return:  the set with one added element of CEntity, if the elemnt was not already included in the set
+        */
+        template <typename TType>
+        friend CSetT<TType> operator + (CSetT<TType>&& aSet, const typename TSetTraits<TType>::TEntity& aVal);
  
         /*
         * Method: is subset of
@@ -208,7 +336,23 @@ public:
         * Parameters:	aVal  is  CSet Value
         * Return: set of elements which are common for both sets
         */
-        CSet intersection(const CSet& aVal) const;
+        CSet intersection(const CSet& aVal) const &;
+
+        /*
+        * Method: intersection (temporary set)
+        * Details: it removes elements, which are not in the set in parameter, directly from the temporary calling set
+        * Parameters:	aVal  is  CSet Value
+        * Return: set of elements which are common for both sets
+        */
+        CSet intersection(const CSet& aVal) &&;
+
+        /*
+        * Method: symmetric difference
+        * Details: it makes symmetric difference of calling set and the set in parameter
+        * Parameters:	aVal  is  CSet Value
+        * Return: set of elements of the calling set which are not in aVal, followed by elements of aVal which are not in the calling set
+        */
+        CSet symmetric_difference(const CSet& aVal) const;
 
         /*
         * Method: is subset of
@@ -233,14 +377,21 @@ public:
 		 * Details:  It has no Parameters:
 		 * Return:   Number of active elements of the set
 		 */
-		size_t num_of_elements() const { return iSize; }
+		size_t num_of_elements() const { return iValues.Size(); }
 
 		/*
         * Method: Complement of the set
 		* Parameters:	aVal  is  CSet Value
 		* Return:  new set with all elements of the first set that were not included in the second
 		*/
-		CSet complement(const CSet& aVal) const;
+		CSet complement(const CSet& aVal) const &;
+
+		/*
+        * Method: Complement of the set (temporary set)
+		* Parameters:	aVal  is  CSet Value
+		* Return:  the temporary set without elements included in the second
+		*/
+		CSet complement(const CSet& aVal) &&;
 
 		/*
         * Method: Section of the set - smaller
@@ -256,6 +407,81 @@ public:
 		*/
 		CSet section_larger(const CEntity& aVal) const;
 
+		/*
+        * Method: Section of the set - range
+		* Details: range is found by binary search in ordered index, elements of the result keep insertion order
+		* Parameters:	aLow and aHigh are CEntity bounds of the range, aLowInclusive and aHighInclusive select whether the bounds belong to the range
+		* Return:  new set with all elements that have values between given bounds
+		*/
+		CSet section(const CEntity& aLow, const CEntity& aHigh, bool aLowInclusive = true, bool aHighInclusive = true) const;
+
+		/*
+        * Method: Count of elements in range
+		* Details: counts elements of section(aLow, aHigh, aLowInclusive, aHighInclusive) in O(log N) without creating the set
+		* Parameters:	aLow and aHigh are CEntity bounds of the range, aLowInclusive and aHighInclusive select whether the bounds belong to the range
+		* Return:  number of elements that have values between given bounds
+		*/
+		size_t count_in_range(const CEntity& aLow, const CEntity& aHigh, bool aLowInclusive = true, bool aHighInclusive = true) const;
+
+		/*
+        * Method: Batch membership test
+		* Details: small sets of CDouble values compare all candidates with all elements by SIMD kernel (see CDoubleKernels), other sets use hash index
+		* Parameters:	aValues are checked values (at most 64, otherwise std::invalid_argument is thrown)
+		* Return:  bit mask, bit i is set when aValues[i] is element of the set
+		*/
+		uint64_t contains_many(std::span<const TValue> aValues) const;
+
+		/*
+        * Method: Elements within radius
+		* Details: for TPoint sets, squared Euclidean distances are computed by SIMD kernel over columns of coordinates (see CPointColumns),
+		* for CDouble sets the distance is absolute difference of values (see IsWithin() of value types),
+		* throws std::invalid_argument for negative or NaN radius (infinite radius selects all elements with finite distance)
+		* Parameters:	aCenter is CEntity center, aRadius is maximal distance from the center
+		* Return:  new set with all elements, which are within aRadius from aCenter (in insertion order)
+		*/
+		CSet within(const CEntity& aCenter, double aRadius) const;
+
+		/*
+        * Method: Spatial index
+		* Details: enables uniform grid (see CSpatialGrid) for nearest and box queries of this set (and of its copies and results), the grid follows add() and erase(),
+		* other modifications rebuild it at the next query; cell size should be close to typical distance of searched neighbours,
+		* throws std::invalid_argument for negative or not finite size
+		* Parameters:	aCellSize is size of grid cell, 0 disables the grid (queries scan all elements then)
+		*/
+		void spatial_index(double aCellSize);
+
+		/*
+        * Method: Nearest element
+		* Details: throws std::runtime_error when the set is empty
+		* Parameters:	aPoint is CEntity searched point
+		* Return:  element with the smallest Euclidean distance from aPoint (elements with the same distance are ordered by Order() of values)
+		*/
+		CEntity nearest(const CEntity& aPoint) const;
+
+		/*
+        * Method: Nearest elements
+		* Parameters:	aPoint is CEntity searched point, aCount is number of searched elements
+		* Return:  new set with at most aCount elements nearest to aPoint, ordered by distance
+		*/
+		CSet nearest(const CEntity& aPoint, size_t aCount) const;
+
+		/*
+        * Method: Elements in box
+		* Parameters:	aLow and aHigh are CEntity opposite corners of axis aligned box (borders belong to the box)
+		* Return:  new set with all elements inside of the box (in insertion order)
+		*/
+		CSet box(const CEntity& aLow, const CEntity& aHigh) const;
+
+		/*
+        * Method: Tolerance
+		* Details: selects how add(), erase(), is_element_of() and contains_many() of this set (and of its copies and results of its operations) match elements:
+		* add() skips values matching some element, erase() removes all matching elements, matching uses quantized index (see CToleranceIndex),
+		* so it stays O(1) per value; set operations and parsing still compare exactly and elements already stored are not merged,
+		* throws std::invalid_argument for negative or not finite tolerance
+		* Parameters:	aMode is mode of matching, aTolerance is maximal difference (whole units in the last place in Ulp mode)
+		*/
+		void tolerance(TToleranceMode aMode, double aTolerance = 0);
+
         /*
         * Method: Addition of element
         * Parameters:	aVal  is  CEntity Value
@@ -285,22 +511,58 @@ public:
         * Details: returns true if set is empty, otherwise returns false
         * Return:  bool value according to whether the set is empty or not
         */
-        bool is_empty() const { return (iSize == 0); }
+        bool is_empty() const { return (iValues.Size() == 0); }
 
         /*
         * Method: Is element of
-        * Details: checks if the given elemenet of CEntity is inluded in the set
+        * Details: checks if the given elemenet of CEntity is inluded in the set, lookup goes through hash index in expected O(1)
         * Return:  bool value according to whether the set contains the given element
         */
         bool is_element_of(const CEntity& aVal) const;
 
         /*
         * Method: First element
-        * Details: gets you pointer on first instance of CEntity in set
+        * Details: gets you pointer on first instance of CEntity in set, linear list of CEntity nodes is materialized from stored values by the first call.
+        * The list is a view of stored values, it is valid until the set is modified. Values written through the nodes change only the list,
+        * they are not stored into the set and they are dropped with the list by the next modification (the set is changed only by its methods).
         * Return:  CEntity pointer of first element
         */
         CEntity* first_elem() const;
 
+        /*
+        * Method: Begin
+        * Details: gets you iterator on the first value of the set, so the set can be used in range-for, <algorithm> and std::ranges
+        * Return:  const_iterator on the first value (in insertion order)
+        */
+        const_iterator begin() const { return iValues.begin(); }
+
+        /*
+        * Method: End
+        * Return:  const_iterator behind the last value
+        */
+        const_iterator end() const { return iValues.end(); }
+
+        /*
+        * Method: Constant begin
+        * Return:  const_iterator on the first value (in insertion order)
+        */
+        const_iterator cbegin() const { return iValues.begin(); }
+
+        /*
+        * Method: Constant end
+        * Return:  const_iterator behind the last value
+        */
+        const_iterator cend() const { return iValues.end(); }
+
+        /*
+        * Method: Next element
+        * Details: gets you pointer on following node of the linear list returned by first_elem(). All nodes of the list are created by the set
+        * as CEntity, so the step is resolved statically, without dynamic_cast of NextItem() result.
+        * Parameters:	aVal  is  pointer on node of the linear list
+        * Return:  CEntity pointer of next element, nullptr for the last element
+        */
+        static CEntity* next_elem(const CEntity* aVal) { return static_cast<CEntity*>(aVal->NextItem()); }
+
 private:
 
         /*
@@ -315,14 +577,32 @@ private:
         * Return: Return -1 or 0 or 1
         */
         int Compare(const CSet& aVal) const;
-	}; /* class CSet */
+	}; /* class CSetT */
+
+/*
+ * CSet type
+ * Set of the CEntity variant selected in CEntity.h
+ */
+using CSet = CSetT<decltype(std::declval<const CEntity&>().Value())>;
+
+extern template class CSetT<CEntity_CDouble::CDouble>;
+extern template class CSetT<CEntity_TPoint::TPoint>;
 
 /*
 * Method: Reverse 2
 * Parameters:	aVal  is  CSet Value
 * Return:  new set based on reversed linear list of given CSet parameter
 */
-CSet Reverse(const CSet& aVal);
+template <typename TElement>
+CSetT<TElement> Reverse(const CSetT<TElement>& aVal);
+
+/*
+* Method: Reverse 2 (temporary set)
+* Parameters:	aVal  is  temporary CSet Value
+* Return:  the same set with reversed order of elements
+*/
+template <typename TElement>
+CSetT<TElement> Reverse(CSetT<TElement>&& aVal);
 
 
 #endif /* __CSet_H__ */
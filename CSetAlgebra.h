@@ -0,0 +1,86 @@
+#ifndef __CSetAlgebra_H__
+#define __CSetAlgebra_H__
+/*
+*  File: CSetAlgebra.h
+*  Brief: CSortedRun class header
+*  Details: File contain sorted view of set elements, which is used by CSet for intersection, difference and subset tests.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+/*
+ * CSortedRun class
+ * Details: Sorted values of a set together with their positions (slots of the storage), viewed in ordered index of the set (see COrderedIndex).
+ * Values are sorted by Order() method of the value type (CDouble or TPoint), so two runs are merged in linear time without sorting.
+ * Result of the merge is a mask indexed by positions, so the caller can keep insertion order of elements.
+ * The run does not own the arrays, it is valid as long as the viewed index.
+ */
+template <typename TValue>
+class CSortedRun {
+    std::span<const TValue> iValues; ///< Values sorted by Order()
+    std::span<const size_t> iPos; ///< Positions of sorted values
+    size_t iPositions; ///< Number of positions of the owner (size of masks returned by Common())
+
+public:
+    /*
+    * Method: C'tor
+    * Parameters: aValues are values sorted by Order(), aPos are their positions, aPositions is number of positions of the owner
+    */
+    CSortedRun(std::span<const TValue> aValues, std::span<const size_t> aPos, size_t aPositions) : iValues(aValues), iPos(aPos), iPositions(aPositions) {}
+
+    /*
+    * Method: Size
+    * Return: number of values in the run
+    */
+    size_t Size() const { return iValues.size(); }
+
+    /*
+    * Method: Common elements
+    * Details: merges both sorted runs, values with equivalent order are confirmed by operator== (NaN values are never common)
+    * Parameters: aOther is sorted run of the other set
+    * Return: mask indexed by positions of this run, true for values which are included in aOther
+    */
+    std::vector<bool> Common(const CSortedRun& aOther) const {
+        std::vector<bool> common(iPositions, false);
+        size_t i = 0, j = 0;
+        while (i < iValues.size() && j < aOther.iValues.size()) {
+            auto order = iValues[i].Order(aOther.iValues[j]);
+            if (order < 0) ++i;
+            else if (order > 0) ++j;
+            else {
+                size_t i_end = i + 1, j_end = j + 1;
+                while (i_end < iValues.size() && iValues[i_end].Order(iValues[i]) == 0) ++i_end;
+                while (j_end < aOther.iValues.size() && aOther.iValues[j_end].Order(aOther.iValues[j]) == 0) ++j_end;
+                for (size_t k = i; k < i_end; ++k) {
+                    for (size_t l = j; l < j_end; ++l) {
+                        if (iValues[k] == aOther.iValues[l]) {
+                            common[iPos[k]] = true;
+                            break;
+                        }
+                    }
+                }
+                i = i_end;
+                j = j_end;
+            }
+        }
+        return common;
+    }
+
+    /*
+    * Method: Includes
+    * Parameters: aOther is sorted run of the other set
+    * Return: true when every value of aOther is included in this run
+    */
+    bool Includes(const CSortedRun& aOther) const {
+        std::vector<bool> common = aOther.Common(*this);
+        for (size_t pos : aOther.iPos) {
+            if (!common[pos]) return false;
+        }
+        return true;
+    }
+}; /* class CSortedRun */
+
+#endif /* __CSetAlgebra_H__ */
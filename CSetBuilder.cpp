@@ -0,0 +1,218 @@
+/*
+* File: CSetBuilder.cpp
+* Brief description: CSetBuilder class implementation
+* Details: File contain incremental builder of CSet from text arriving in chunks.
+* Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <fstream>
+#include <queue>
+#include <stdexcept>
+
+#include "CSetBuilder.h"
+#include "CSetFile.h"
+#include "CEntity_CDouble.h"
+#include "CEntity_TPoint.h"
+
+// Internal functions
+
+/*
+ * Reader of one spilled run
+ */
+template <typename TValue>
+struct TRunReader {
+    std::FILE* iFile; ///< Temporary file of the run
+    std::vector<TValue> iBuffer; ///< Block of values read from the file
+    size_t iPos = 0; ///< Position of the next value in iBuffer
+
+    /*
+    * Method: Next value
+    * Parameters: aValue is place for the value
+    * Return: false when the run is exhausted
+    */
+    bool Next(TValue& aValue) {
+        if (iPos == iBuffer.size()) {
+            iBuffer.resize(4096);
+            iBuffer.resize(std::fread(iBuffer.data(), sizeof(TValue), iBuffer.size(), iFile));
+            iPos = 0;
+            if (iBuffer.empty()) return false;
+        }
+        aValue = iBuffer[iPos++];
+        return true;
+    }
+};
+
+/*
+ * Merge
+ * Details: merges sorted runs, equal values are passed only once
+ * Parameters: aRuns and aCount define merged runs, aOnValue is callable with const TValue& parameter called for every distinct value in Order()
+ */
+template <typename TValue, typename TFunc>
+static void Merge(std::FILE* const* aRuns, size_t aCount, TFunc aOnValue) {
+    std::vector<TRunReader<TValue>> readers;
+    readers.reserve(aCount);
+    for (size_t i = 0; i < aCount; ++i) readers.push_back({ aRuns[i], {}, 0 });
+    using THead = std::pair<TValue, size_t>;
+    auto greater = [](const THead& aLeft, const THead& aRight) { return aLeft.first.Order(aRight.first) > 0; };
+    std::priority_queue<THead, std::vector<THead>, decltype(greater)> heads(greater);
+    TValue value;
+    for (size_t i = 0; i < readers.size(); ++i) {
+        if (readers[i].Next(value)) heads.push({ value, i });
+    }
+    std::vector<TValue> group; // distinct values of actual class of equivalent values
+    while (!heads.empty()) {
+        THead head = heads.top();
+        heads.pop();
+        if (readers[head.second].Next(value)) heads.push({ value, head.second });
+        if (!group.empty() && group.front().Order(head.first) != 0) group.clear();
+        if (std::find(group.begin(), group.end(), head.first) == group.end()) {
+            group.push_back(head.first);
+            aOnValue(head.first);
+        }
+    }
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::Scan(std::string_view aText) {
+    size_t end = ScanSetText<TValue>(aText, iStrict, [&](const TValue& aValue) {
+        if (iSet.iValues.Insert(aValue) && iMemoryLimit != 0 && iSet.num_of_elements() >= iMemoryLimit) Spill();
+    }, iOffset);
+    iOffset += end;
+    CheckCarry(aText.size() - end);
+    iCarry = std::string(aText.substr(end));
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::CheckCarry(size_t aSize) const {
+    if (aSize > KCarryMax) throw std::invalid_argument("Unterminated set element at offset " + std::to_string(iOffset));
+}
+
+template <typename TElement>
+std::FILE* CSetBuilderT<TElement>::NewRun() {
+    std::FILE* run = std::tmpfile();
+    if (run == nullptr) throw std::runtime_error("Cannot create temporary file for set values!");
+    iRuns.push_back(run);
+    return run;
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::Spill() {
+    std::vector<TValue> values(iSet.begin(), iSet.end());
+    std::sort(values.begin(), values.end(), [](const TValue& aLeft, const TValue& aRight) { return aLeft.Order(aRight) < 0; });
+    std::FILE* run = NewRun();
+    if (std::fwrite(values.data(), sizeof(TValue), values.size(), run) != values.size() || std::fflush(run) != 0)
+        throw std::runtime_error("Cannot write temporary file for set values!");
+    std::rewind(run);
+    iSet = CSet();
+}
+
+template <typename TElement>
+template <typename TFunc>
+void CSetBuilderT<TElement>::MergeRuns(TFunc aOnValue) {
+    if (!iSet.is_empty()) Spill();
+    // merged runs are taken from the front and their result is appended at the end, so every value is rewritten about log(runs) / log(KMergeFanIn) times
+    while (iRuns.size() > KMergeFanIn) {
+        std::FILE* run = NewRun();
+        Merge<TValue>(iRuns.data(), KMergeFanIn, [&](const TValue& aValue) {
+            if (std::fwrite(&aValue, sizeof(TValue), 1, run) != 1) throw std::runtime_error("Cannot write temporary file for set values!");
+        });
+        if (std::fflush(run) != 0) throw std::runtime_error("Cannot write temporary file for set values!");
+        std::rewind(run);
+        for (size_t i = 0; i < KMergeFanIn; ++i) std::fclose(iRuns[i]);
+        iRuns.erase(iRuns.begin(), iRuns.begin() + KMergeFanIn);
+    }
+    Merge<TValue>(iRuns.data(), iRuns.size(), aOnValue);
+    CloseRuns();
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::CheckEnd() {
+    bool unterminated = !iCarry.empty();
+    size_t offset = iOffset;
+    iCarry.clear();
+    iOffset = 0;
+    if (unterminated && iStrict) throw std::invalid_argument("Unterminated set element at offset " + std::to_string(offset));
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::CloseRuns() {
+    for (std::FILE* run : iRuns) std::fclose(run);
+    iRuns.clear();
+}
+
+//Methods
+template <typename TElement>
+void CSetBuilderT<TElement>::feed(std::string_view aChunk) {
+    if (!iCarry.empty()) {
+        size_t close = aChunk.find(']');
+        if (close == std::string_view::npos) {
+            CheckCarry(iCarry.size() + aChunk.size());
+            iCarry.append(aChunk);
+            return;
+        }
+        std::string head = iCarry;
+        head.append(aChunk.substr(0, close + 1));
+        Scan(head);
+        aChunk.remove_prefix(close + 1);
+    }
+    Scan(aChunk);
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::feed(std::istream& aIStream, size_t aBlockSize) {
+    std::string block(aBlockSize, '\0');
+    while (aIStream.read(block.data(), std::streamsize(aBlockSize)) || aIStream.gcount() > 0) {
+        feed(std::string_view(block.data(), size_t(aIStream.gcount())));
+    }
+}
+
+template <typename TElement>
+CSetT<TElement> CSetBuilderT<TElement>::finish() {
+    CheckEnd();
+    if (iRuns.empty()) {
+        CSet result = std::move(iSet);
+        iSet = CSet();
+        return result;
+    }
+    CSet result;
+    MergeRuns([&](const TValue& aValue) { result.iValues.Insert(aValue); });
+    return result;
+}
+
+template <typename TElement>
+void CSetBuilderT<TElement>::finish(const char* aFileName) {
+    CheckEnd();
+    if (iRuns.empty()) {
+        CSetFileT<TElement>::Save(iSet, aFileName);
+        iSet = CSet();
+        return;
+    }
+    std::ofstream file(aFileName, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error(std::string("Cannot create set file ") + aFileName);
+    using CFile = CSetFileT<TElement>;
+    typename CFile::TFileHeader header = { { 'C', 'S', 'E', 'T' }, CFile::KVersion, TValue::KTypeTag, uint32_t(sizeof(TValue)), CFile::KByteOrder, 0, 0 };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // values come in Order(), so NaN-like values are only at the beginning and at the end, all other positions form one sorted range
+    uint64_t first_ordered = 0, last_ordered = 0;
+    MergeRuns([&](const TValue& aValue) {
+        if (aValue == aValue) {
+            if (header.iOrderCount == 0) first_ordered = header.iCount;
+            last_ordered = header.iCount;
+            ++header.iOrderCount;
+        }
+        file.write(reinterpret_cast<const char*>(&aValue), sizeof(TValue));
+        ++header.iCount;
+    });
+    for (uint64_t pos = first_ordered; header.iOrderCount != 0 && pos <= last_ordered; ++pos) {
+        file.write(reinterpret_cast<const char*>(&pos), sizeof(pos));
+    }
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file) throw std::runtime_error(std::string("Cannot write set file ") + aFileName);
+}
+
+// Explicit instantiations for supported value types (see TSetTraits)
+
+template class CSetBuilderT<CEntity_CDouble::CDouble>;
+template class CSetBuilderT<CEntity_TPoint::TPoint>;
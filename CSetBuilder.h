@@ -0,0 +1,150 @@
+#ifndef __CSetBuilder_H__
+#define __CSetBuilder_H__
+/*
+*  File: CSetBuilder.h
+*  Brief: CSetBuilder class header
+*  Details: File contain incremental builder of CSet from text arriving in chunks.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CSet.h"
+
+/*
+ * CSetBuilderT class
+ * Details: Text in "[v],[v],..." format is fed in chunks of any size (element can be split between chunks), values are deduplicated as they come.
+ * With memory limit, distinct values are kept in memory only up to the limit, then they are sorted by Order() and spilled into temporary file.
+ * Spilled runs are merged (and deduplicated across runs) by finish(), so elements of such result are ordered by Order() instead of insertion order.
+ * At most KMergeFanIn runs are read at once, more runs are merged in passes into new temporary runs first, so read buffers stay bounded.
+ * Element split between chunks is kept until its closing ], element longer than KCarryMax characters is reported as unterminated (in both modes).
+ * Element type is template parameter as in CSetT, member functions are defined in CSetBuilder.cpp and instantiated there for both supported types.
+ */
+template <typename TElement>
+class CSetBuilderT
+	{
+public:
+    using CSet = CSetT<TElement>; ///< Type of built sets
+    using TValue = TElement; ///< Type of parsed values
+
+    static constexpr size_t KMergeFanIn = 16; ///< Maximal number of runs merged at once
+    static constexpr size_t KCarryMax = 4 * TValue::KCharsMax; ///< Maximal length of unterminated element kept between chunks
+
+private:
+    bool iStrict; ///< Error mode of parsing (see CSet::parse)
+    size_t iMemoryLimit; ///< Maximal number of values kept in memory, 0 for no limit
+    CSet iSet; ///< Values since the last spill
+    std::string iCarry; ///< Unterminated element from the end of the last chunk
+    size_t iOffset = 0; ///< Offset of the first character of iCarry in the whole input
+    std::vector<std::FILE*> iRuns; ///< Temporary files with spilled sorted runs
+
+    /*
+    * Method: Scan
+    * Details: parses complete elements of the text and keeps unterminated end in iCarry
+    * Parameters: aText is parsed text, which starts at offset iOffset of the input
+    */
+    void Scan(std::string_view aText);
+
+    /*
+    * Method: Check carry
+    * Details: throws std::invalid_argument, when unterminated element would be longer than KCarryMax characters
+    * Parameters: aSize is length of the element
+    */
+    void CheckCarry(size_t aSize) const;
+
+    /*
+    * Method: New run
+    * Details: creates new temporary file and appends it to iRuns, throws std::runtime_error when the file can not be created
+    * Return: the file
+    */
+    std::FILE* NewRun();
+
+    /*
+    * Method: Spill
+    * Details: sorts values in memory, writes them into new temporary file and clears the set
+    */
+    void Spill();
+
+    /*
+    * Method: Merge runs
+    * Details: merges all spilled runs, equal values are passed only once; while there are more than KMergeFanIn runs,
+    * the first KMergeFanIn runs are merged into new run at the end of iRuns
+    * Parameters: aOnValue is callable with const TValue& parameter called for every distinct value in Order()
+    */
+    template <typename TFunc>
+    void MergeRuns(TFunc aOnValue);
+
+    /*
+    * Method: Check end
+    * Details: checks that the input did not end inside of element (in strict mode)
+    */
+    void CheckEnd();
+
+    /*
+    * Method: Close runs
+    * Details: closes and removes all temporary files
+    */
+    void CloseRuns();
+
+public:
+    /*
+    * Method: C'tor
+    * Parameters: aStrict selects error mode: true throws std::invalid_argument with offset of the first malformed or unterminated element, false skips them,
+    * aMemoryLimit is maximal number of distinct values kept in memory (0 disables spilling into temporary files)
+    */
+    explicit CSetBuilderT(bool aStrict = true, size_t aMemoryLimit = 0) : iStrict(aStrict), iMemoryLimit(aMemoryLimit) {}
+
+    CSetBuilderT(const CSetBuilderT&) = delete;
+    CSetBuilderT& operator=(const CSetBuilderT&) = delete;
+
+    /*
+    * Method: D'tor
+    * Details: removes temporary files of spilled runs
+    */
+    ~CSetBuilderT() { CloseRuns(); }
+
+    /*
+    * Method: Feed
+    * Details: parses next chunk of the input, throws std::invalid_argument for malformed element (in strict mode) and for element longer than KCarryMax
+    * Parameters: aChunk is next part of the text
+    */
+    void feed(std::string_view aChunk);
+
+    /*
+    * Method: Feed from stream
+    * Details: reads the whole stream by blocks and parses them
+    * Parameters: aIStream is input stream, aBlockSize is size of one read block
+    */
+    void feed(std::istream& aIStream, size_t aBlockSize = 1 << 16);
+
+    /*
+    * Method: Finish
+    * Details: ends the input and gives away built set, the builder can be used for new input then
+    * Return: the set with all distinct fed values (in insertion order, or in Order() when values were spilled)
+    */
+    CSet finish();
+
+    /*
+    * Method: Finish into binary file
+    * Details: ends the input and writes the result as binary set file (see CSetFile), spilled runs are merged straight into the file,
+    * so memory stays bounded by the memory limit
+    * Parameters: aFileName is name of the file
+    */
+    void finish(const char* aFileName);
+	}; /* class CSetBuilderT */
+
+/*
+ * CSetBuilder type
+ * Builder of CSet (the CEntity variant selected in CEntity.h)
+ */
+using CSetBuilder = CSetBuilderT<CSet::TValue>;
+
+extern template class CSetBuilderT<CEntity_CDouble::CDouble>;
+extern template class CSetBuilderT<CEntity_TPoint::TPoint>;
+
+#endif /* __CSetBuilder_H__ */
@@ -0,0 +1,350 @@
+#ifndef __CSetExpr_H__
+#define __CSetExpr_H__
+/*
+*  File: CSetExpr.h
+*  Brief: CSetExpr class header
+*  Details: File contain lazy expressions over CSetT operators, which are evaluated in one fused pass.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "CSet.h"
+
+/*
+ * Operation of binary expression node
+ */
+enum class TSetOperation {
+    Union, ///< Elements of the left operand, followed by elements of the right one, which are not in the left one (operator +)
+    Difference, ///< Elements of the left operand, which are not in the right one (operator -, complement)
+    Intersection, ///< Elements of the left operand, which are in the right one
+    SymmetricDifference ///< Elements of the left operand not in the right one, followed by elements of the right one not in the left one
+};
+
+/*
+ * Nodes of expression tree
+ * Details: Every node yields values of its result in the same order as the eager operator of CSetT would store them and answers membership of the result,
+ * so no intermediate set is created. ForEach() calls the function for every value until it returns false and returns false when it was stopped.
+ * Membership is exact (by hash index of operands), tolerance of sets is not used, same as by eager set operations.
+ */
+
+/*
+ * Leaf node referring to set
+ * Details: the set must outlive the expression and must not be modified before the expression is evaluated
+ */
+template <typename TElement>
+struct TSetRef {
+    using TValue = TElement; ///< Type of values
+
+    const CSetT<TElement>& iSet; ///< Referred set
+
+    size_t Bound() const { return iSet.num_of_elements(); }
+    size_t Count() const { return iSet.num_of_elements(); }
+    bool Contains(const TValue& aValue) const { return iSet.iValues.Contains(aValue); }
+    const CSetT<TElement>& Leftmost() const { return iSet; }
+
+    template <typename TFunc>
+    bool ForEach(TFunc&& aFunc) const {
+        const CFlatStorage<TValue>& values = iSet.iValues;
+        const TValue* data = values.Data();
+        for (size_t i = 0; i < values.SlotCount(); ++i) {
+            if (values.Live(i) && !aFunc(data[i])) return false;
+        }
+        return true;
+    }
+};
+
+/*
+ * Node of binary set operation
+ */
+template <typename TLeft, typename TRight, TSetOperation KOperation>
+struct TSetBinary {
+    using TValue = typename TLeft::TValue; ///< Type of values
+
+    TLeft iLeft; ///< Left operand
+    TRight iRight; ///< Right operand
+
+    // upper bound of the number of values, used for reserving memory
+    size_t Bound() const {
+        if constexpr (KOperation == TSetOperation::Union || KOperation == TSetOperation::SymmetricDifference) return iLeft.Bound() + iRight.Bound();
+        else return iLeft.Bound();
+    }
+
+    // set of the leftmost leaf, its settings are inherited by the result
+    const auto& Leftmost() const { return iLeft.Leftmost(); }
+
+    size_t Count() const {
+        size_t count = 0;
+        if constexpr (KOperation == TSetOperation::Union) {
+            count = iLeft.Count();
+            iRight.ForEach([&](const TValue& aValue) { count += !iLeft.Contains(aValue); return true; });
+        }
+        else if constexpr (KOperation == TSetOperation::Intersection) {
+            // order of values does not matter for counting, so the smaller operand is walked
+            if (iRight.Bound() < iLeft.Bound()) iRight.ForEach([&](const TValue& aValue) { count += iLeft.Contains(aValue); return true; });
+            else iLeft.ForEach([&](const TValue& aValue) { count += iRight.Contains(aValue); return true; });
+        }
+        else ForEach([&](const TValue&) { ++count; return true; });
+        return count;
+    }
+
+    bool Contains(const TValue& aValue) const {
+        if constexpr (KOperation == TSetOperation::Union) return iLeft.Contains(aValue) || iRight.Contains(aValue);
+        else if constexpr (KOperation == TSetOperation::Difference) return iLeft.Contains(aValue) && !iRight.Contains(aValue);
+        else if constexpr (KOperation == TSetOperation::Intersection) return iLeft.Contains(aValue) && iRight.Contains(aValue);
+        else return iLeft.Contains(aValue) != iRight.Contains(aValue);
+    }
+
+    template <typename TFunc>
+    bool ForEach(TFunc&& aFunc) const {
+        if constexpr (KOperation == TSetOperation::Union) {
+            if (!iLeft.ForEach(aFunc)) return false;
+            return iRight.ForEach([&](const TValue& aValue) { return iLeft.Contains(aValue) || aFunc(aValue); });
+        }
+        else if constexpr (KOperation == TSetOperation::Difference) return iLeft.ForEach([&](const TValue& aValue) { return iRight.Contains(aValue) || aFunc(aValue); });
+        else if constexpr (KOperation == TSetOperation::Intersection) return iLeft.ForEach([&](const TValue& aValue) { return !iRight.Contains(aValue) || aFunc(aValue); });
+        else {
+            if (!iLeft.ForEach([&](const TValue& aValue) { return iRight.Contains(aValue) || aFunc(aValue); })) return false;
+            return iRight.ForEach([&](const TValue& aValue) { return iLeft.Contains(aValue) || aFunc(aValue); });
+        }
+    }
+};
+
+/*
+ * Node of section (range of values)
+ * Details: bounds are compared by operators < and <= of values, same as by section methods of CSetT
+ */
+template <typename TNode>
+struct TSetSection {
+    using TValue = typename TNode::TValue; ///< Type of values
+
+    TNode iNode; ///< Filtered operand
+    TValue iLow; ///< Lower bound (if iHasLow)
+    TValue iHigh; ///< Upper bound (if iHasHigh)
+    bool iHasLow; ///< Range has lower bound
+    bool iHasHigh; ///< Range has upper bound
+    bool iLowInclusive; ///< Values equal to iLow belong to the range
+    bool iHighInclusive; ///< Values equal to iHigh belong to the range
+
+    bool InRange(const TValue& aValue) const {
+        if (iHasLow && !(iLowInclusive ? iLow <= aValue : iLow < aValue)) return false;
+        if (iHasHigh && !(iHighInclusive ? aValue <= iHigh : aValue < iHigh)) return false;
+        return true;
+    }
+
+    size_t Bound() const { return iNode.Bound(); }
+    const auto& Leftmost() const { return iNode.Leftmost(); }
+
+    size_t Count() const {
+        size_t count = 0;
+        ForEach([&](const TValue&) { ++count; return true; });
+        return count;
+    }
+
+    bool Contains(const TValue& aValue) const { return InRange(aValue) && iNode.Contains(aValue); }
+
+    template <typename TFunc>
+    bool ForEach(TFunc&& aFunc) const {
+        return iNode.ForEach([&](const TValue& aValue) { return !InRange(aValue) || aFunc(aValue); });
+    }
+};
+
+/*
+ * CSetExpr class
+ * Details: Lazy expression over sets, which is created by lazy() and combined by the same operators and methods as CSetT (operator +, operator -,
+ * intersection(), complement(), symmetric_difference() and sections). Combining only builds the tree of operations, values are not touched.
+ * The result is produced in one fused pass, when the expression is converted to CSetT (assignment, initialization) or walked by for_each(),
+ * elements of the result have the same order as by eager operators. num_of_elements(), is_empty() and is_element_of() are answered
+ * from the operands without creating the result (is_empty() stops at the first value).
+ * Expression refers to the sets, so they must outlive it and must not be modified before it is evaluated.
+ */
+template <typename TNode>
+class CSetExpr
+	{
+public:
+    using TValue = typename TNode::TValue; ///< Type of values
+    using CSet = CSetT<TValue>; ///< Type of the result set
+    using CEntity = typename CSet::CEntity; ///< Node class of the result set
+
+private:
+    TNode iNode; ///< Root node of the expression tree
+
+    template <typename TOther>
+    friend class CSetExpr;
+
+    static TSetRef<TValue> Node(const CSet& aVal) { return { aVal }; }
+
+    template <typename TOther>
+    static const TOther& Node(const CSetExpr<TOther>& aVal) { return aVal.iNode; }
+
+    template <typename TOperand>
+    using TNodeOf = std::decay_t<decltype(Node(std::declval<const TOperand&>()))>; ///< Node of operand (set or expression)
+
+    template <TSetOperation KOperation, typename TOperand>
+    CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, KOperation>> Combine(const TOperand& aVal) const {
+        return CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, KOperation>>({ iNode, Node(aVal) });
+    }
+
+    CSetExpr<TSetSection<TNode>> Section(const TValue* aLow, bool aLowInclusive, const TValue* aHigh, bool aHighInclusive) const {
+        return CSetExpr<TSetSection<TNode>>({ iNode, aLow ? *aLow : TValue(), aHigh ? *aHigh : TValue(), aLow != nullptr, aHigh != nullptr, aLowInclusive, aHighInclusive });
+    }
+
+public:
+    /*
+    * Method: C'tor
+    * Parameters: aNode is root node of the expression tree
+    */
+    explicit CSetExpr(TNode aNode) : iNode(std::move(aNode)) {}
+
+    /*
+    * Method: Binary operator plus
+    * Parameters: aVal is set or expression
+    * Return: expression of union
+    */
+    template <typename TOperand>
+    CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, TSetOperation::Union>> operator +(const TOperand& aVal) const { return Combine<TSetOperation::Union>(aVal); }
+
+    /*
+    * Method: Binary operator minus
+    * Parameters: aVal is set or expression
+    * Return: expression of difference
+    */
+    template <typename TOperand>
+    CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, TSetOperation::Difference>> operator -(const TOperand& aVal) const { return Combine<TSetOperation::Difference>(aVal); }
+
+    /*
+    * Method: Complement of the set
+    * Parameters: aVal is set or expression
+    * Return: expression of difference
+    */
+    template <typename TOperand>
+    CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, TSetOperation::Difference>> complement(const TOperand& aVal) const { return Combine<TSetOperation::Difference>(aVal); }
+
+    /*
+    * Method: intersection
+    * Parameters: aVal is set or expression
+    * Return: expression of intersection
+    */
+    template <typename TOperand>
+    CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, TSetOperation::Intersection>> intersection(const TOperand& aVal) const { return Combine<TSetOperation::Intersection>(aVal); }
+
+    /*
+    * Method: symmetric difference
+    * Parameters: aVal is set or expression
+    * Return: expression of symmetric difference
+    */
+    template <typename TOperand>
+    CSetExpr<TSetBinary<TNode, TNodeOf<TOperand>, TSetOperation::SymmetricDifference>> symmetric_difference(const TOperand& aVal) const { return Combine<TSetOperation::SymmetricDifference>(aVal); }
+
+    /*
+    * Method: Section of the set - smaller
+    * Parameters: aVal is CEntity Value
+    * Return: expression of elements, which have smaller values then given CEntity value
+    */
+    CSetExpr<TSetSection<TNode>> section_smaller(const CEntity& aVal) const {
+        TValue high = aVal.Value();
+        return Section(nullptr, false, &high, false);
+    }
+
+    /*
+    * Method: Section of the set - larger
+    * Parameters: aVal is CEntity Value
+    * Return: expression of elements, which have larger values then given CEntity value
+    */
+    CSetExpr<TSetSection<TNode>> section_larger(const CEntity& aVal) const {
+        TValue low = aVal.Value();
+        return Section(&low, false, nullptr, false);
+    }
+
+    /*
+    * Method: Section of the set - range
+    * Parameters: aLow and aHigh are CEntity bounds of the range, aLowInclusive and aHighInclusive select whether the bounds belong to the range
+    * Return: expression of elements, which have values between given bounds
+    */
+    CSetExpr<TSetSection<TNode>> section(const CEntity& aLow, const CEntity& aHigh, bool aLowInclusive = true, bool aHighInclusive = true) const {
+        TValue low = aLow.Value(), high = aHigh.Value();
+        return Section(&low, aLowInclusive, &high, aHighInclusive);
+    }
+
+    /*
+    * Method: Number of elements
+    * Details: counts values of the result without creating it
+    * Return: number of elements of the result
+    */
+    size_t num_of_elements() const { return iNode.Count(); }
+
+    /*
+    * Method: Is empty
+    * Details: stops at the first value of the result
+    * Return: true when the result has no elements
+    */
+    bool is_empty() const { return iNode.ForEach([](const TValue&) { return false; }); }
+
+    /*
+    * Method: Is element of
+    * Details: answered by membership of the value in the operands, exact matching is used
+    * Parameters: aVal is searched element
+    * Return: true when the result contains the element
+    */
+    bool is_element_of(const TValue& aVal) const { return iNode.Contains(aVal); }
+    bool is_element_of(const CEntity& aVal) const { return iNode.Contains(aVal.Value()); }
+
+    /*
+    * Method: For each
+    * Details: walks values of the result in one fused pass without creating it
+    * Parameters: aFunc is callable with const TValue& parameter called for every value (in order of the result)
+    */
+    template <typename TFunc>
+    void for_each(TFunc aFunc) const { iNode.ForEach([&](const TValue& aValue) { aFunc(aValue); return true; }); }
+
+    /*
+    * Method: Evaluate
+    * Details: collects values of the result in one fused pass and stores them into the set at once
+    * Return: the result set, it inherits settings of the leftmost operand as results of CSetT operations do
+    */
+    CSet evaluate() const {
+        std::vector<TValue> values;
+        values.reserve(iNode.Bound());
+        iNode.ForEach([&](const TValue& aValue) { values.push_back(aValue); return true; });
+        CSet result = iNode.Leftmost().Derived();
+        result.iValues.Append(values.data(), values.size());
+        return result;
+    }
+
+    /*
+    * Method: Operator CSet
+    * Details: evaluates the expression, so it can be assigned to a set or used as its initializer
+    * Return: the result set
+    */
+    operator CSet() const { return evaluate(); }
+	}; /* class CSetExpr */
+
+/*
+ * Method: Lazy
+ * Parameters: aSet is set, which must outlive the expression
+ * Return: expression with the set as its only operand
+ */
+template <typename TElement>
+CSetExpr<TSetRef<TElement>> lazy(const CSetT<TElement>& aSet) {
+    return CSetExpr<TSetRef<TElement>>({ aSet });
+}
+
+/*
+ * Method: Non-member operator plus
+ * Details: set combined with expression stays lazy (it is not converted into set)
+ * Return: expression of union
+ */
+template <typename TElement, typename TNode>
+auto operator +(const CSetT<TElement>& aSet, const CSetExpr<TNode>& aVal) { return lazy(aSet) + aVal; }
+
+/*
+ * Method: Non-member operator minus
+ * Details: set combined with expression stays lazy (it is not converted into set)
+ * Return: expression of difference
+ */
+template <typename TElement, typename TNode>
+auto operator -(const CSetT<TElement>& aSet, const CSetExpr<TNode>& aVal) { return lazy(aSet) - aVal; }
+
+#endif /* __CSetExpr_H__ */
@@ -0,0 +1,190 @@
+/*
+* File: CSetFile.cpp
+* Brief description: CSetFile class implementation
+* Details: File contain binary file format of CSet and read-only view of the file mapped into memory.
+* Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CSETFILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CSetFile.h"
+#include "CEntity_CDouble.h"
+#include "CEntity_TPoint.h"
+
+static_assert(sizeof(CSetFile::TFileHeader) == 32, "Header of binary set file has to be packed");
+
+// Internal functions
+
+template <typename TElement>
+void CSetFileT<TElement>::Unmap() {
+#ifdef CSETFILE_MMAP
+    if (iMap) ::munmap(iMap, iMapSize);
+#endif
+    iMap = nullptr;
+    iMapSize = 0;
+    iValues = nullptr;
+    iOrder = nullptr;
+}
+
+template <typename TElement>
+const TElement& CSetFileT<TElement>::Sorted(size_t aIndex) const {
+    if (iOrder[aIndex] >= iCount) throw std::runtime_error("Set file has wrong position in sorted array!");
+    return iValues[iOrder[aIndex]];
+}
+
+// binary searches go over indexes of the sorted array, so every read position is checked by Sorted()
+template <typename TPred>
+static size_t PartitionPoint(size_t aCount, TPred aPred) {
+    size_t first = 0;
+    while (aCount > 0) {
+        size_t half = aCount / 2;
+        if (aPred(first + half)) {
+            first += half + 1;
+            aCount -= half + 1;
+        }
+        else aCount = half;
+    }
+    return first;
+}
+
+template <typename TElement>
+size_t CSetFileT<TElement>::SmallerCount(const TValue& aVal) const {
+    return PartitionPoint(iOrderCount, [&](size_t aIndex) { return Sorted(aIndex) < aVal; });
+}
+
+template <typename TElement>
+CSetT<TElement> CSetFileT<TElement>::Collect(size_t aFirst, size_t aLast) const {
+    std::vector<uint64_t> positions(iOrder + aFirst, iOrder + aLast);
+    std::sort(positions.begin(), positions.end());
+    if (!positions.empty() && positions.back() >= iCount) throw std::runtime_error("Set file has wrong position in sorted array!");
+    CSet result;
+    result.iValues.Reserve(positions.size());
+    for (uint64_t pos : positions) result.iValues.Insert(iValues[pos]);
+    return result;
+}
+
+//C'tors
+template <typename TElement>
+CSetFileT<TElement>::CSetFileT(const char* aFileName) {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef CSETFILE_MMAP
+    int fd = ::open(aFileName, O_RDONLY);
+    if (fd < 0) throw std::runtime_error(std::string("Cannot open set file ") + aFileName);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error(std::string("Cannot read set file ") + aFileName);
+    }
+    size = size_t(info.st_size);
+    if (size < sizeof(TFileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Set file is too short!");
+    }
+    iMap = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (iMap == MAP_FAILED) iMap = nullptr;
+    ::close(fd);
+    if (iMap == nullptr) throw std::runtime_error(std::string("Cannot map set file ") + aFileName);
+    iMapSize = size;
+    data = static_cast<const unsigned char*>(iMap);
+#else
+    std::ifstream file(aFileName, std::ios::binary | std::ios::ate);
+    if (!file) throw std::runtime_error(std::string("Cannot open set file ") + aFileName);
+    size = size_t(file.tellg());
+    iBuffer.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(iBuffer.data()), std::streamsize(size));
+    if (file.gcount() != std::streamsize(size)) throw std::runtime_error(std::string("Cannot read set file ") + aFileName);
+    data = reinterpret_cast<const unsigned char*>(iBuffer.data());
+#endif
+    TFileHeader header;
+    if (size < sizeof(header)) {
+        Unmap();
+        throw std::runtime_error("Set file is too short!");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    bool valid = std::memcmp(header.iMagic, "CSET", 4) == 0 && header.iVersion == KVersion && header.iType == TValue::KTypeTag
+        && header.iValueSize == sizeof(TValue) && header.iByteOrder == KByteOrder && header.iOrderCount <= header.iCount
+        && header.iCount <= (size - sizeof(header)) / sizeof(TValue)
+        && size == sizeof(header) + header.iCount * sizeof(TValue) + header.iOrderCount * sizeof(uint64_t);
+    if (!valid) {
+        Unmap();
+        throw std::runtime_error("Set file has wrong format, version or value type!");
+    }
+    iCount = size_t(header.iCount);
+    iOrderCount = size_t(header.iOrderCount);
+    iValues = reinterpret_cast<const TValue*>(data + sizeof(header));
+    iOrder = reinterpret_cast<const uint64_t*>(data + sizeof(header) + iCount * sizeof(TValue));
+}
+
+template <typename TElement>
+CSetFileT<TElement>::~CSetFileT() {
+    Unmap();
+}
+
+//Methods
+template <typename TElement>
+void CSetFileT<TElement>::Save(const CSet& aSet, const char* aFileName) {
+    std::vector<TValue> values(aSet.begin(), aSet.end());
+    std::vector<uint64_t> order;
+    order.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i] == values[i]) order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](uint64_t aLeft, uint64_t aRight) { return values[aLeft].Order(values[aRight]) < 0; });
+    TFileHeader header = { { 'C', 'S', 'E', 'T' }, KVersion, TValue::KTypeTag, uint32_t(sizeof(TValue)), KByteOrder, values.size(), order.size() };
+    std::ofstream file(aFileName, std::ios::binary | std::ios::trunc);
+    if (!file) throw std::runtime_error(std::string("Cannot create set file ") + aFileName);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(values.data()), std::streamsize(values.size() * sizeof(TValue)));
+    file.write(reinterpret_cast<const char*>(order.data()), std::streamsize(order.size() * sizeof(uint64_t)));
+    if (!file) throw std::runtime_error(std::string("Cannot write set file ") + aFileName);
+}
+
+template <typename TElement>
+bool CSetFileT<TElement>::is_element_of(const CEntity& aVal) const {
+    TValue value = aVal.Value();
+    size_t first = PartitionPoint(iOrderCount, [&](size_t aIndex) { return Sorted(aIndex).Order(value) < 0; });
+    for (; first != iOrderCount && Sorted(first).Order(value) == 0; ++first) {
+        if (Sorted(first) == value) return true;
+    }
+    return false;
+}
+
+template <typename TElement>
+CSetT<TElement> CSetFileT<TElement>::section_smaller(const CEntity& aVal) const {
+    return Collect(0, SmallerCount(aVal.Value()));
+}
+
+template <typename TElement>
+CSetT<TElement> CSetFileT<TElement>::section_larger(const CEntity& aVal) const {
+    TValue value = aVal.Value();
+    size_t first = PartitionPoint(iOrderCount, [&](size_t aIndex) { return !(value < Sorted(aIndex)); });
+    return Collect(first, iOrderCount);
+}
+
+template <typename TElement>
+CSetT<TElement> CSetFileT<TElement>::to_set() const {
+    CSet result;
+    result.iValues.Reserve(iCount);
+    for (size_t i = 0; i < iCount; ++i) result.iValues.Insert(iValues[i]);
+    return result;
+}
+
+// Explicit instantiations for supported value types (see TSetTraits)
+
+template class CSetFileT<CEntity_CDouble::CDouble>;
+template class CSetFileT<CEntity_TPoint::TPoint>;
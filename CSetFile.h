@@ -0,0 +1,157 @@
+#ifndef __CSetFile_H__
+#define __CSetFile_H__
+/*
+*  File: CSetFile.h
+*  Brief: CSetFile class header
+*  Details: File contain binary file format of CSet and read-only view of the file mapped into memory.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "CSet.h"
+
+/*
+ * CSetFileT class
+ * Details: Binary file of the set consists of header, packed array of values in insertion order and array of value positions sorted by Order()
+ * (values, which are not equal to itself like NaN, are left out of the sorted array, because they are never found and never compared as smaller or larger).
+ * Opened file is mapped into memory (or read at once, where mapping is not available), queries are answered directly from the mapped arrays,
+ * without building the set. Opening checks only the header, so it does not touch the arrays; positions are checked by queries when they are read
+ * (broken sorted array can give wrong results of queries, but it is never read outside of the file).
+ * Element type is template parameter as in CSetT, member functions are defined in CSetFile.cpp and instantiated there for both supported types.
+ */
+template <typename TElement>
+class CSetFileT
+	{
+public:
+    using CSet = CSetT<TElement>; ///< Type of sets read from the file
+    using CEntity = typename CSet::CEntity; ///< Node class of the set
+    using TValue = TElement; ///< Type of stored values
+    static_assert(std::is_trivially_copyable_v<TValue>, "Values have to be trivially copyable for packed binary storage");
+    static_assert(sizeof(TValue) % sizeof(uint64_t) == 0, "Arrays of binary set file have to stay aligned");
+
+    /*
+    * Header of the file
+    */
+    struct TFileHeader {
+        char iMagic[4]; ///< "CSET"
+        uint16_t iVersion; ///< Version of the format (KVersion)
+        uint16_t iType; ///< Tag of value type (TValue::KTypeTag)
+        uint32_t iValueSize; ///< Size of one packed value
+        uint32_t iByteOrder; ///< KByteOrder written in byte order of the writer
+        uint64_t iCount; ///< Number of values
+        uint64_t iOrderCount; ///< Number of positions in sorted array
+    };
+
+    static constexpr uint16_t KVersion = 1; ///< Actual version of the format
+    static constexpr uint32_t KByteOrder = 0x01020304; ///< Byte order mark
+
+private:
+    const TValue* iValues = nullptr; ///< Values in insertion order
+    const uint64_t* iOrder = nullptr; ///< Positions of values sorted by Order()
+    size_t iCount = 0; ///< Number of values
+    size_t iOrderCount = 0; ///< Number of sorted positions
+    void* iMap = nullptr; ///< Mapped file (nullptr when the file was read into iBuffer)
+    size_t iMapSize = 0; ///< Size of mapped file
+    std::vector<uint64_t> iBuffer; ///< Content of the file, when mapping is not available
+
+    /*
+    * Method: Unmap
+    * Details: releases mapped file
+    */
+    void Unmap();
+
+    /*
+    * Method: Value at sorted position
+    * Details: throws std::runtime_error when the position stored in the file points outside of the values
+    * Parameters: aIndex is index into the sorted array
+    * Return: value at the position
+    */
+    const TValue& Sorted(size_t aIndex) const;
+
+    /*
+    * Method: Range of smaller values
+    * Parameters: aVal is compared value
+    * Return: number of leading sorted positions, which hold values smaller than aVal
+    */
+    size_t SmallerCount(const TValue& aVal) const;
+
+    /*
+    * Method: Collect
+    * Details: creates set from positions in the sorted array, elements are kept in insertion order
+    * Parameters: aFirst and aLast define range of the sorted array
+    * Return: new set
+    */
+    CSet Collect(size_t aFirst, size_t aLast) const;
+
+public:
+    /*
+    * Method: Conversion c'tor from file name
+    * Details: opens and maps the file, checks its header, throws std::runtime_error when the file can not be used
+    * Parameters: aFileName is name of the file
+    */
+    explicit CSetFileT(const char* aFileName);
+
+    CSetFileT(const CSetFileT&) = delete;
+    CSetFileT& operator=(const CSetFileT&) = delete;
+
+    /*
+    * Method: D'tor
+    * Details: unmaps the file
+    */
+    ~CSetFileT();
+
+    /*
+    * Method: Save
+    * Details: writes the set into binary file, throws std::runtime_error when the file can not be written
+    * Parameters: aSet is saved set, aFileName is name of the file
+    */
+    static void Save(const CSet& aSet, const char* aFileName);
+
+    /*
+    * Method: Number of elements of the set
+    * Return:   Number of elements stored in the file
+    */
+    size_t num_of_elements() const { return iCount; }
+
+    /*
+    * Method: Is element of
+    * Details: checks if the given element is stored in the file, binary search over the sorted array
+    * Return:  bool value according to whether the file contains the given element
+    */
+    bool is_element_of(const CEntity& aVal) const;
+
+    /*
+    * Method: Section of the set - smaller
+    * Parameters:	aVal  is  CEntity Value
+    * Return:  new set with all elements that have smaller values then given CEntity value
+    */
+    CSet section_smaller(const CEntity& aVal) const;
+
+    /*
+    * Method: Section of the set - larger
+    * Parameters:	aVal  is  CEntity Value
+    * Return:  new set with all elements that have larger values then given CEntity value
+    */
+    CSet section_larger(const CEntity& aVal) const;
+
+    /*
+    * Method: To set
+    * Return:  new set with all stored elements in insertion order
+    */
+    CSet to_set() const;
+	}; /* class CSetFileT */
+
+/*
+ * CSetFile type
+ * Binary file of CSet (the CEntity variant selected in CEntity.h)
+ */
+using CSetFile = CSetFileT<CSet::TValue>;
+
+extern template class CSetFileT<CEntity_CDouble::CDouble>;
+extern template class CSetFileT<CEntity_TPoint::TPoint>;
+
+#endif /* __CSetFile_H__ */
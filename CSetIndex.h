@@ -0,0 +1,227 @@
+#ifndef __CSetIndex_H__
+#define __CSetIndex_H__
+/*
+*  File: CSetIndex.h
+*  Brief: CSetIndex class header
+*  Details: File contain open addressing hash index, which CSet keeps next to its linear list.
+*  Author: Martin Bezecny
+*/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CParallel.h"
+
+/*
+ * CSetIndex class
+ * Details: Hash table with open addressing (linear probing) keyed on encapsulated values (CDouble or TPoint).
+ * Key type has to provide Hash() method and operator==. Every key is stored together with one mapped value,
+ * which is used by the owner container for locating the node in its own storage.
+ * Removing of keys uses backward shift, so the table does not need any tombstones.
+ */
+template <typename TKey, typename TMapped>
+class CSetIndex {
+
+    /*
+    * Slot of the table
+    */
+    struct TSlot {
+        TKey iKey; ///< Stored key
+        TMapped iMapped; ///< Value mapped to the key
+        bool iUsed = false; ///< Slot is occupied
+    };
+
+    static constexpr size_t KParallelChunk = 1 << 15; ///< Minimal number of keys inserted by one thread of Build()
+
+    std::vector<TSlot> iSlots; ///< Table of slots, its size is always power of two (or zero)
+    size_t iCount = 0; ///< Number of occupied slots
+
+    /*
+    * Method: Home slot
+    * Details: mixes bits of key hash (64 bit finalizer) and maps it onto the table
+    * Parameters: aKey is searched key
+    * Return: index of the home slot of given key
+    */
+    size_t Home(const TKey& aKey) const {
+        uint64_t h = static_cast<uint64_t>(aKey.Hash());
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return static_cast<size_t>(h) & (iSlots.size() - 1);
+    }
+
+    /*
+    * Method: Slot lookup
+    * Parameters: aKey is searched key
+    * Return: index of the slot holding given key, or iSlots.size() when the key is not present
+    */
+    size_t Locate(const TKey& aKey) const {
+        if (iCount == 0) return iSlots.size();
+        size_t mask = iSlots.size() - 1;
+        for (size_t i = Home(aKey); iSlots[i].iUsed; i = (i + 1) & mask) {
+            if (iSlots[i].iKey == aKey) return i;
+        }
+        return iSlots.size();
+    }
+
+    /*
+    * Method: Rehash
+    * Details: moves all keys into new table with given capacity
+    * Parameters: aCapacity is new number of slots (power of two)
+    */
+    void Rehash(size_t aCapacity) {
+        std::vector<TSlot> old(aCapacity);
+        old.swap(iSlots);
+        size_t mask = iSlots.size() - 1;
+        for (TSlot& slot : old) {
+            if (!slot.iUsed) continue;
+            size_t i = Home(slot.iKey);
+            while (iSlots[i].iUsed) i = (i + 1) & mask;
+            iSlots[i] = slot;
+        }
+    }
+
+public:
+    CSetIndex() = default;
+    CSetIndex(const CSetIndex&) = default;
+    CSetIndex& operator=(const CSetIndex&) = default;
+
+    /*
+    * Method: Move c'tor
+    * Details: takes over the table, original index is left empty
+    * Parameters: aVal is moved index
+    */
+    CSetIndex(CSetIndex&& aVal) noexcept : iSlots(std::move(aVal.iSlots)), iCount(std::exchange(aVal.iCount, 0)) { aVal.iSlots.clear(); }
+
+    /*
+    * Method: Move assignment operator
+    * Details: takes over the table, original index is left empty
+    * Parameters: aVal is moved index
+    */
+    CSetIndex& operator=(CSetIndex&& aVal) noexcept {
+        iSlots = std::move(aVal.iSlots);
+        iCount = std::exchange(aVal.iCount, 0);
+        aVal.iSlots.clear();
+        return *this;
+    }
+
+    /*
+    * Method: Reserve
+    * Details: grows the table, so that aCount keys can be stored without another rehashing (load factor is kept under 1/2)
+    * Parameters: aCount is expected number of keys
+    */
+    void Reserve(size_t aCount) {
+        size_t capacity = 16;
+        while (capacity < aCount * 2) capacity <<= 1;
+        if (capacity > iSlots.size()) Rehash(capacity);
+    }
+
+    /*
+    * Method: Build
+    * Details: replaces content of the index by given distinct keys, every key is mapped to its position. Keys are known to be distinct,
+    * so inserting thread never compares keys, it only claims the first free slot of the probe sequence by atomic flag,
+    * which lets large tables be filled by several threads at once (see CParallel)
+    * Parameters: aKeys is array of keys, aCount is number of keys, aLive is callable with size_t position returning false for keys, which are skipped
+    */
+    template <typename TLive>
+    void Build(const TKey* aKeys, size_t aCount, TLive aLive) {
+        Clear();
+        size_t count = 0;
+        for (size_t i = 0; i < aCount; ++i) count += aLive(i) ? 1 : 0;
+        Reserve(count);
+        iCount = count;
+        size_t mask = iSlots.size() - 1;
+        CParallel::For(aCount, KParallelChunk, [&](size_t aBegin, size_t aEnd) {
+            for (size_t i = aBegin; i < aEnd; ++i) {
+                if (!aLive(i)) continue;
+                size_t slot = Home(aKeys[i]);
+                for (bool used = false; !std::atomic_ref<bool>(iSlots[slot].iUsed).compare_exchange_strong(used, true, std::memory_order_relaxed); used = false) slot = (slot + 1) & mask;
+                iSlots[slot].iKey = aKeys[i];
+                iSlots[slot].iMapped = TMapped(i);
+            }
+        });
+    }
+
+    /*
+    * Method: Find
+    * Parameters: aKey is searched key
+    * Return: pointer on value mapped to the key, nullptr when the key is not present
+    */
+    TMapped* Find(const TKey& aKey) {
+        size_t i = Locate(aKey);
+        return (i == iSlots.size()) ? nullptr : &iSlots[i].iMapped;
+    }
+
+    /*
+    * Method: Find (const variant)
+    * Parameters: aKey is searched key
+    * Return: pointer on value mapped to the key, nullptr when the key is not present
+    */
+    const TMapped* Find(const TKey& aKey) const {
+        size_t i = Locate(aKey);
+        return (i == iSlots.size()) ? nullptr : &iSlots[i].iMapped;
+    }
+
+    /*
+    * Method: Insert
+    * Details: stores new key, already present key is left untouched
+    * Parameters: aKey is inserted key, aMapped is value mapped to the key
+    * Return: true if the key was inserted, false if it was already present
+    */
+    bool Insert(const TKey& aKey, const TMapped& aMapped) {
+        if ((iCount + 1) * 2 > iSlots.size()) Reserve(iCount + 1);
+        size_t mask = iSlots.size() - 1;
+        size_t i = Home(aKey);
+        for (; iSlots[i].iUsed; i = (i + 1) & mask) {
+            if (iSlots[i].iKey == aKey) return false;
+        }
+        iSlots[i].iKey = aKey;
+        iSlots[i].iMapped = aMapped;
+        iSlots[i].iUsed = true;
+        ++iCount;
+        return true;
+    }
+
+    /*
+    * Method: Erase
+    * Details: removes the key and shifts following keys of the probe sequence back
+    * Parameters: aKey is removed key
+    * Return: true if the key was removed, false if it was not present
+    */
+    bool Erase(const TKey& aKey) {
+        size_t hole = Locate(aKey);
+        if (hole == iSlots.size()) return false;
+        size_t mask = iSlots.size() - 1;
+        for (size_t i = (hole + 1) & mask; iSlots[i].iUsed; i = (i + 1) & mask) {
+            size_t home = Home(iSlots[i].iKey);
+            // key can fill the hole only when the hole lies between its home slot and its current slot
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                iSlots[hole] = iSlots[i];
+                hole = i;
+            }
+        }
+        iSlots[hole].iUsed = false;
+        --iCount;
+        return true;
+    }
+
+    /*
+    * Method: Clear
+    * Details: removes all keys and releases the table
+    */
+    void Clear() {
+        std::vector<TSlot>().swap(iSlots);
+        iCount = 0;
+    }
+
+    /*
+    * Method: Count
+    * Return: number of stored keys
+    */
+    size_t Count() const { return iCount; }
+}; /* class CSetIndex */
+
+#endif /* __CSetIndex_H__ */
@@ -0,0 +1,50 @@
+#ifndef __CSetText_H__
+#define __CSetText_H__
+/*
+*  File: CSetText.h
+*  Brief: Text format of CSet
+*  Details: File contain scanner of the "[v],[v],..." text format, which is shared by CSet parsing methods.
+*  Author: Martin Bezecny
+*/
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/*
+* Method: Scan set text
+* Details: finds elements in [ ] in the text and parses their content by TValue::FromChars (CDouble or TPoint), characters outside of [ ] are ignored.
+* The text is not copied. Scanning stops in front of the last element, when its closing ] is missing, so the rest can be completed later.
+* Parameters: aText is scanned text, aStrict selects error mode, aOnValue is callable with const TValue& parameter called for every parsed element,
+* aBase is offset of the text in the whole input (used in error messages)
+* In the strict mode malformed element throws std::invalid_argument with its offset, otherwise malformed elements are skipped
+* (number followed by another characters is accepted, as it is by the stream operator).
+* Return: offset of the first character, which was not scanned (size of the text, or position of unterminated element)
+*/
+template <typename TValue, typename TFunc>
+size_t ScanSetText(std::string_view aText, bool aStrict, TFunc aOnValue, size_t aBase = 0) {
+    size_t pos = 0;
+    while (true) {
+        size_t open = aText.find('[', pos);
+        if (open == std::string_view::npos) return aText.size();
+        size_t close = aText.find(']', open + 1);
+        if (close == std::string_view::npos) return open;
+        const char* first = aText.data() + open + 1;
+        const char* last = aText.data() + close;
+        TValue value;
+        const char* end = TValue::FromChars(first, last, value);
+        if (end != nullptr) {
+            while (end != last && (*end == ' ' || *end == ';' || *end == '\t' || *end == '\n' || *end == '\r')) ++end;
+        }
+        if (end != nullptr && (end == last || !aStrict)) {
+            aOnValue(value);
+        }
+        else if (aStrict) {
+            throw std::invalid_argument("Malformed set element at offset " + std::to_string(aBase + open));
+        }
+        pos = close + 1;
+    }
+}
+
+#endif /* __CSetText_H__ */
@@ -0,0 +1,64 @@
+#ifndef __CSetTraits_H__
+#define __CSetTraits_H__
+/*
+*  File: CSetTraits.h
+*  Brief: TSetTraits structure header
+*  Details: File contain compile-time description of value types, which can be stored in CSetT.
+*  Author: Martin Bezecny
+*/
+
+#include <charconv>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <type_traits>
+
+#include "CEntity_CDouble.h"
+#include "CEntity_TPoint.h"
+
+/*
+ * TSetValueTraits structure
+ * Details: Checks interface, which CSetT and its indexes use on stored values: hashing (Hash() consistent with operator==),
+ * ordering (Order() giving std::weak_ordering), parsing and formatting (FromChars() and ToChars() of std::from_chars and std::to_chars kind)
+ * and coordinates for spatial indexes (KAxes and Coordinate()). Values are copied by bytes, so they have to be trivially copyable.
+ */
+template <typename TValue>
+struct TSetValueTraits {
+    static constexpr bool KHashed = requires(const TValue& aValue) {
+        { aValue.Hash() } -> std::convertible_to<size_t>;
+        { aValue == aValue } -> std::convertible_to<bool>;
+    }; ///< Value can be kept in hash indexes
+    static constexpr bool KOrdered = requires(const TValue& aValue) {
+        { aValue.Order(aValue) } -> std::convertible_to<std::weak_ordering>;
+    }; ///< Value can be kept in ordered index and sorted runs
+    static constexpr bool KParsed = requires(const TValue& aValue, TValue& aResult, const char* aFirst, char* aOut) {
+        { TValue::FromChars(aFirst, aFirst, aResult) } -> std::same_as<const char*>;
+        { aValue.ToChars(aOut, aOut, 6) } -> std::same_as<char*>;
+        { TValue::KCharsMax } -> std::convertible_to<size_t>;
+    }; ///< Value can be parsed from set text and formatted into it
+    static constexpr bool KSpatial = requires(const TValue& aValue) {
+        { TValue::KAxes } -> std::convertible_to<size_t>;
+        { aValue.Coordinate(size_t(0)) } -> std::convertible_to<double>;
+    }; ///< Value has coordinates for spatial and tolerance indexes
+    static constexpr bool KFlat = std::is_trivially_copyable_v<TValue>; ///< Value can be copied by bytes
+};
+
+/*
+ * TSetTraits structure
+ * Details: Binds value type to the CEntity variant, which is used for nodes of materialized linear list and for arguments of CSetT methods.
+ * It is defined only for supported value types, so CSetT of other types does not compile.
+ */
+template <typename TValue>
+struct TSetTraits;
+
+template <>
+struct TSetTraits<CEntity_CDouble::CDouble> : TSetValueTraits<CEntity_CDouble::CDouble> {
+    using TEntity = CEntity_CDouble::CEntity; ///< Node class of CDouble sets
+};
+
+template <>
+struct TSetTraits<CEntity_TPoint::TPoint> : TSetValueTraits<CEntity_TPoint::TPoint> {
+    using TEntity = CEntity_TPoint::CEntity; ///< Node class of TPoint sets
+};
+
+#endif /* __CSetTraits_H__ */
@@ -0,0 +1,312 @@
+#ifndef __CSpatialGrid_H__
+#define __CSpatialGrid_H__
+/*
+*  File: CSpatialGrid.h
+*  Brief: CSpatialGrid class header
+*  Details: File contain uniform grid of set values, which is used by CSet for nearest neighbour and box queries.
+*  Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CValidFlag.h"
+
+/*
+ * CSpatialGrid class
+ * Details: Space is divided into cubic cells of given size, every value is stored in the cell containing its coordinates
+ * (value type has to provide Coordinate(axis) for axes 0 to 2, CDouble values lie on the first axis). Only occupied cells are kept in hash map,
+ * values with coordinates out of the grid (infinite, NaN or too large) are kept aside and checked by every query.
+ * Values are inserted and erased one by one, so the grid can follow add() and erase() of the owner without rebuilding.
+ * Distances are compared as squares (dx * dx + dy * dy + dz * dz), like IsWithin() of value types.
+ * Values are kept in the cells by value (not by slot), so compaction of the storage does not touch the grid.
+ */
+template <typename TValue>
+class CSpatialGrid {
+    /*
+    * Coordinates of cell
+    */
+    struct TCell {
+        int64_t iX; ///< Index of cell on X axis
+        int64_t iY; ///< Index of cell on Y axis
+        int64_t iZ; ///< Index of cell on Z axis
+
+        bool operator==(const TCell& aCell) const = default;
+    };
+
+    /*
+    * Hash of cell coordinates
+    */
+    struct TCellHash {
+        size_t operator()(const TCell& aCell) const {
+            uint64_t hash = uint64_t(aCell.iX) * 0x9e3779b97f4a7c15ULL;
+            hash = (hash ^ (hash >> 29) ^ uint64_t(aCell.iY)) * 0xbf58476d1ce4e5b9ULL;
+            hash = (hash ^ (hash >> 32) ^ uint64_t(aCell.iZ)) * 0x94d049bb133111ebULL;
+            return size_t(hash ^ (hash >> 31));
+        }
+    };
+
+    static constexpr double KCellLimit = 4.0e18; ///< Maximal absolute cell index, values beyond are kept aside
+
+    double iCellSize = 0; ///< Size of cell edge, 0 when the grid is disabled
+    CValidFlag iValid; ///< Grid holds actual content of the storage
+    std::unordered_map<TCell, std::vector<TValue>, TCellHash> iCells; ///< Occupied cells
+    std::vector<TValue> iOutliers; ///< Values out of the grid
+    size_t iCount = 0; ///< Number of values in the grid (outliers included)
+
+    /*
+    * Method: Cell index on axis
+    * Return: false when the coordinate is out of the grid
+    */
+    bool Index(double aCoordinate, int64_t& aIndex) const {
+        double index = std::floor(aCoordinate / iCellSize);
+        if (!(std::fabs(index) <= KCellLimit)) return false;
+        aIndex = int64_t(index);
+        return true;
+    }
+
+    /*
+    * Method: Cell of value
+    * Return: false when the value is out of the grid
+    */
+    bool CellOf(const TValue& aValue, TCell& aCell) const {
+        return Index(aValue.Coordinate(0), aCell.iX) && Index(aValue.Coordinate(1), aCell.iY) && Index(aValue.Coordinate(2), aCell.iZ);
+    }
+
+    /*
+    * Method: Bucket of value
+    * Return: vector, which holds (or would hold) the value
+    */
+    std::vector<TValue>* Bucket(const TValue& aValue) {
+        TCell cell;
+        if (!CellOf(aValue, cell)) return &iOutliers;
+        auto found = iCells.find(cell);
+        return (found == iCells.end()) ? nullptr : &found->second;
+    }
+
+    /*
+    * Method: For each cell in cube
+    * Details: calls given function for every occupied cell with indices between aLow and aHigh, the cube is enumerated cell by cell
+    * when it has less cells than the map, otherwise occupied cells are filtered
+    */
+    template <typename TFunc>
+    void ForEachCell(const TCell& aLow, const TCell& aHigh, TFunc aFunc) const {
+        double cells = double(aHigh.iX - aLow.iX + 1) * double(aHigh.iY - aLow.iY + 1) * double(aHigh.iZ - aLow.iZ + 1);
+        if (cells > double(iCells.size())) {
+            for (const auto& [cell, values] : iCells) {
+                if (cell.iX >= aLow.iX && cell.iX <= aHigh.iX && cell.iY >= aLow.iY && cell.iY <= aHigh.iY && cell.iZ >= aLow.iZ && cell.iZ <= aHigh.iZ) aFunc(values);
+            }
+            return;
+        }
+        for (int64_t x = aLow.iX; x <= aHigh.iX; ++x) {
+            for (int64_t y = aLow.iY; y <= aHigh.iY; ++y) {
+                for (int64_t z = aLow.iZ; z <= aHigh.iZ; ++z) {
+                    auto found = iCells.find(TCell{ x, y, z });
+                    if (found != iCells.end()) aFunc(found->second);
+                }
+            }
+        }
+    }
+
+public:
+    using TRanked = std::pair<double, TValue>; ///< Value with its squared distance from searched point
+
+    /*
+    * Method: Rank
+    * Parameters: aPoint is searched point, aValue is candidate value
+    * Return: candidate with squared distance from the point (NaN distance is replaced by infinity, so such values go last)
+    */
+    static TRanked Rank(const TValue& aPoint, const TValue& aValue) {
+        double dx = aValue.Coordinate(0) - aPoint.Coordinate(0), dy = aValue.Coordinate(1) - aPoint.Coordinate(1), dz = aValue.Coordinate(2) - aPoint.Coordinate(2);
+        double distance = dx * dx + dy * dy + dz * dz;
+        return TRanked((distance == distance) ? distance : HUGE_VAL, aValue);
+    }
+
+    /*
+    * Method: Closer
+    * Return: true when the left candidate is nearer than the right one (candidates with the same distance are ordered by Order())
+    */
+    static bool Closer(const TRanked& aLeft, const TRanked& aRight) {
+        if (aLeft.first != aRight.first) return aLeft.first < aRight.first;
+        return aLeft.second.Order(aRight.second) < 0;
+    }
+
+    /*
+    * Method: Cell size getter
+    * Return: size of cell edge, 0 when the grid is disabled
+    */
+    double CellSize() const { return iCellSize; }
+
+    /*
+    * Method: Enabled
+    * Return: true when the owner asked for the grid
+    */
+    bool Enabled() const { return iCellSize > 0; }
+
+    /*
+    * Method: Valid
+    * Return: true when the grid was built and not invalidated since
+    */
+    bool Valid() const { return iValid.Get(); }
+
+    /*
+    * Method: Enable
+    * Details: sets size of cells, the grid has to be built then
+    * Parameters: aCellSize is size of cell edge (0 disables the grid)
+    */
+    void Enable(double aCellSize) {
+        Invalidate();
+        iCellSize = aCellSize;
+    }
+
+    /*
+    * Method: Invalidate
+    * Details: drops content of the grid, size of cells is kept
+    */
+    void Invalidate() {
+        iCells.clear();
+        iOutliers.clear();
+        iCount = 0;
+        iValid.Set(false);
+    }
+
+    /*
+    * Method: Build
+    * Details: inserts all values of the storage
+    * Parameters: aStorage is indexed storage (CFlatStorage)
+    */
+    template <typename TStorage>
+    void Build(const TStorage& aStorage) {
+        Invalidate();
+        iCells.reserve(aStorage.Size());
+        aStorage.ForEach([&](const TValue& aValue) { Insert(aValue); });
+        iValid.Set(true);
+    }
+
+    /*
+    * Method: Insert
+    * Parameters: aValue is new value (not present in the grid yet)
+    */
+    void Insert(const TValue& aValue) {
+        TCell cell;
+        if (CellOf(aValue, cell)) iCells[cell].push_back(aValue);
+        else iOutliers.push_back(aValue);
+        ++iCount;
+    }
+
+    /*
+    * Method: Erase
+    * Parameters: aValue is erased value
+    */
+    void Erase(const TValue& aValue) {
+        std::vector<TValue>* bucket = Bucket(aValue);
+        if (bucket == nullptr) return;
+        auto found = std::find(bucket->begin(), bucket->end(), aValue);
+        if (found == bucket->end()) return;
+        *found = bucket->back();
+        bucket->pop_back();
+        --iCount;
+        TCell cell;
+        if (bucket->empty() && CellOf(aValue, cell)) iCells.erase(cell);
+    }
+
+    /*
+    * Method: Nearest values
+    * Details: cells are visited in growing cubic shells around the cell of aPoint, search ends when no value of further shells
+    * can be nearer than the k-th found value (or when all cells were visited)
+    * Parameters: aPoint is center of the search, aCount is number of searched values
+    * Return: at most aCount nearest values ordered by distance (values with the same distance by Order())
+    */
+    std::vector<TValue> Nearest(const TValue& aPoint, size_t aCount) const {
+        std::vector<TRanked> best; // heap of the best candidates, the farthest one on the top
+        auto offer = [&](const std::vector<TValue>& aValues) {
+            for (const TValue& value : aValues) {
+                TRanked candidate = Rank(aPoint, value);
+                if (best.size() < aCount) {
+                    best.push_back(candidate);
+                    std::push_heap(best.begin(), best.end(), Closer);
+                }
+                else if (Closer(candidate, best.front())) {
+                    std::pop_heap(best.begin(), best.end(), Closer);
+                    best.back() = candidate;
+                    std::push_heap(best.begin(), best.end(), Closer);
+                }
+            }
+        };
+        if (aCount == 0 || iCount == 0) return {};
+        offer(iOutliers);
+        TCell center;
+        if (!CellOf(aPoint, center)) {
+            for (const auto& cell : iCells) offer(cell.second);
+        }
+        else {
+            size_t visited = 0;
+            for (int64_t shell = 0; visited < iCells.size(); ++shell) {
+                double reach = double(shell - 2) * iCellSize; // values from this shell on are at least this far (one cell is spared for rounding of cell indices)
+                if (shell > 2 && best.size() == aCount && best.front().first < reach * reach) break;
+                double side = double(2 * shell + 1), cells = side * side * side - (shell ? (side - 2) * (side - 2) * (side - 2) : 0);
+                if (cells > double(iCells.size() - visited)) { // shells grew larger than the map, the rest is filtered
+                    for (const auto& [cell, values] : iCells) {
+                        int64_t distance = std::max({ std::abs(cell.iX - center.iX), std::abs(cell.iY - center.iY), std::abs(cell.iZ - center.iZ) });
+                        if (distance >= shell) offer(values);
+                    }
+                    break;
+                }
+                for (int64_t x = center.iX - shell; x <= center.iX + shell; ++x) {
+                    for (int64_t y = center.iY - shell; y <= center.iY + shell; ++y) {
+                        bool inner = std::abs(x - center.iX) < shell && std::abs(y - center.iY) < shell;
+                        for (int64_t z = center.iZ - shell; z <= center.iZ + shell; z += (inner ? 2 * shell : 1)) {
+                            auto found = iCells.find(TCell{ x, y, z });
+                            if (found == iCells.end()) continue;
+                            offer(found->second);
+                            ++visited;
+                        }
+                    }
+                }
+            }
+        }
+        std::sort_heap(best.begin(), best.end(), Closer);
+        std::vector<TValue> result;
+        result.reserve(best.size());
+        for (const auto& candidate : best) result.push_back(candidate.second);
+        return result;
+    }
+
+    /*
+    * Method: Values in box
+    * Parameters: aLow and aHigh are opposite corners of axis aligned box (borders included)
+    * Return: values inside of the box (in no particular order)
+    */
+    std::vector<TValue> Box(const TValue& aLow, const TValue& aHigh) const {
+        std::vector<TValue> result;
+        auto inside = [&](const TValue& aValue) {
+            for (size_t axis = 0; axis < 3; ++axis) {
+                if (!(aLow.Coordinate(axis) <= aValue.Coordinate(axis) && aValue.Coordinate(axis) <= aHigh.Coordinate(axis))) return false;
+            }
+            return true;
+        };
+        auto collect = [&](const std::vector<TValue>& aValues) {
+            for (const TValue& value : aValues) {
+                if (inside(value)) result.push_back(value);
+            }
+        };
+        collect(iOutliers);
+        TCell low, high;
+        for (size_t axis = 0; axis < 3; ++axis) {
+            if (!(aLow.Coordinate(axis) <= aHigh.Coordinate(axis))) return result;
+        }
+        if (CellOf(aLow, low) && CellOf(aHigh, high)) ForEachCell(low, high, collect);
+        else {
+            for (const auto& cell : iCells) collect(cell.second);
+        }
+        return result;
+    }
+}; /* class CSpatialGrid */
+
+#endif /* __CSpatialGrid_H__ */
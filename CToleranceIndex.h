@@ -0,0 +1,287 @@
+#ifndef __CToleranceIndex_H__
+#define __CToleranceIndex_H__
+/*
+*  File: CToleranceIndex.h
+*  Brief: CToleranceIndex class header
+*  Details: File contain quantized hash index of set values, which is used by CSet for matching of elements with tolerance.
+*  Author: Martin Bezecny
+*/
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "CValidFlag.h"
+
+/*
+ * Mode of matching elements
+ */
+enum class TToleranceMode {
+    Exact, ///< Values are matched by operator==
+    Absolute, ///< Every coordinate differs at most by the tolerance (absolute difference for CDouble, per axis for TPoint)
+    Euclidean, ///< Euclidean distance is at most the tolerance (compared as squares of distance in units of the tolerance)
+    Ulp ///< Every coordinate differs at most by the tolerance in units in the last place
+};
+
+/*
+ * CToleranceIndex class
+ * Details: Coordinates of values (Coordinate() of the first TValue::KAxes axes) are quantized into cells and values are kept in hash map of cells.
+ * Cells are twice as large as the tolerance (or tolerance + 1 units in the last place), so all matching values lie in the cell of searched value
+ * or in cells next to it, even when quantization rounds at the border of cell. Search of one value visits at most 3 ^ KAxes cells, which keeps matching O(1).
+ * Coordinates too large for the grid (more than KCellLimit cells from 0, infinite) are keyed by their exact bits: the tolerance is far below
+ * one unit in the last place there, so only equal coordinates can match. Values with NaN coordinate never match, they are only kept aside for Erase().
+ * Values are inserted and erased one by one, so the index can follow add() and erase() of the owner without rebuilding.
+ */
+template <typename TValue>
+class CToleranceIndex {
+    static constexpr size_t KAxes = TValue::KAxes; ///< Number of quantized coordinates
+
+    /*
+    * Coordinates of cell
+    */
+    struct TCell {
+        int64_t iKey[3] = { 0, 0, 0 }; ///< Index of cell on every axis
+        uint8_t iExact = 0; ///< Bit mask of axes, which are keyed by exact bits of coordinate (out of the grid)
+
+        bool operator==(const TCell& aCell) const = default;
+    };
+
+    /*
+    * Hash of cell coordinates
+    */
+    struct TCellHash {
+        size_t operator()(const TCell& aCell) const {
+            uint64_t hash = aCell.iExact;
+            for (int64_t key : aCell.iKey) hash = (hash ^ (hash >> 31) ^ uint64_t(key)) * 0x9e3779b97f4a7c15ULL;
+            return size_t(hash ^ (hash >> 29));
+        }
+    };
+
+    static constexpr double KCellLimit = 4.0e18; ///< Maximal absolute cell index, coordinates beyond are keyed by exact bits
+    static constexpr double KUlpLimit = 4.0e18; ///< Maximal tolerance in units in the last place
+
+    TToleranceMode iMode = TToleranceMode::Exact; ///< Mode of matching
+    double iTolerance = 0; ///< Tolerance given by the owner
+    double iCellSize = 0; ///< Size of cell edge (Absolute and Euclidean modes)
+    int64_t iUlpCell = 1; ///< Size of cell edge in units in the last place (Ulp mode)
+    CValidFlag iValid; ///< Index holds actual content of the storage
+    std::unordered_map<TCell, std::vector<TValue>, TCellHash> iCells; ///< Occupied cells
+    std::vector<TValue> iOutliers; ///< Values with NaN coordinate
+
+    /*
+    * Method: Ordered bits
+    * Return: integer, which differs for neighbouring doubles by 1 (0 and -0 give 0)
+    */
+    static int64_t OrderedBits(double aValue) {
+        int64_t bits = std::bit_cast<int64_t>(aValue);
+        return (bits < 0) ? -(bits & INT64_MAX) : bits;
+    }
+
+    /*
+    * Method: Cell index on axis
+    * Details: aExact is set when the coordinate is out of the grid and aIndex holds its exact bits
+    * Return: false when the coordinate is NaN
+    */
+    bool Index(double aCoordinate, int64_t& aIndex, bool& aExact) const {
+        if (!(aCoordinate == aCoordinate)) return false;
+        aExact = false;
+        if (iMode == TToleranceMode::Ulp) {
+            int64_t bits = OrderedBits(aCoordinate);
+            aIndex = bits / iUlpCell - ((bits % iUlpCell < 0) ? 1 : 0);
+            return true;
+        }
+        double index = std::floor(aCoordinate / iCellSize);
+        if (!(std::fabs(index) <= KCellLimit)) {
+            // |coordinate| > 2 * KCellLimit * tolerance, so neighbouring doubles are much farther apart than the tolerance
+            aExact = true;
+            aIndex = OrderedBits(aCoordinate);
+            return true;
+        }
+        aIndex = int64_t(index);
+        return true;
+    }
+
+    /*
+    * Method: Cell of value
+    * Return: false when the value has NaN coordinate
+    */
+    bool CellOf(const TValue& aValue, TCell& aCell) const {
+        for (size_t axis = 0; axis < KAxes; ++axis) {
+            bool exact = false;
+            if (!Index(aValue.Coordinate(axis), aCell.iKey[axis], exact)) return false;
+            if (exact) aCell.iExact |= uint8_t(1u << axis);
+        }
+        return true;
+    }
+
+public:
+    /*
+    * Method: Mode getter
+    * Return: mode of matching
+    */
+    TToleranceMode Mode() const { return iMode; }
+
+    /*
+    * Method: Tolerance getter
+    * Return: tolerance given by the owner
+    */
+    double Tolerance() const { return iTolerance; }
+
+    /*
+    * Method: Enabled
+    * Return: true when values are matched with tolerance
+    */
+    bool Enabled() const { return iMode != TToleranceMode::Exact; }
+
+    /*
+    * Method: Valid
+    * Return: true when the index was built and not invalidated since
+    */
+    bool Valid() const { return iValid.Get(); }
+
+    /*
+    * Method: Enable
+    * Details: sets mode of matching, the index has to be built then, zero tolerance in Absolute and Euclidean modes selects Exact mode
+    * Parameters: aMode is mode of matching, aTolerance is not negative finite tolerance (whole units in Ulp mode)
+    */
+    void Enable(TToleranceMode aMode, double aTolerance) {
+        Invalidate();
+        iMode = (aTolerance == 0 && aMode != TToleranceMode::Ulp) ? TToleranceMode::Exact : aMode;
+        iTolerance = aTolerance;
+        iCellSize = 2 * aTolerance;
+        iUlpCell = int64_t(std::min(std::floor(aTolerance), KUlpLimit)) + 1;
+    }
+
+    /*
+    * Method: Invalidate
+    * Details: drops content of the index, mode of matching is kept
+    */
+    void Invalidate() {
+        iCells.clear();
+        iOutliers.clear();
+        iValid.Set(false);
+    }
+
+    /*
+    * Method: Build
+    * Details: inserts all values of the storage
+    * Parameters: aStorage is indexed storage (CFlatStorage)
+    */
+    template <typename TStorage>
+    void Build(const TStorage& aStorage) {
+        Invalidate();
+        iCells.reserve(aStorage.Size());
+        aStorage.ForEach([&](const TValue& aValue) { Insert(aValue); });
+        iValid.Set(true);
+    }
+
+    /*
+    * Method: Insert
+    * Parameters: aValue is new value (not present in the index yet)
+    */
+    void Insert(const TValue& aValue) {
+        TCell cell;
+        if (CellOf(aValue, cell)) iCells[cell].push_back(aValue);
+        else iOutliers.push_back(aValue);
+    }
+
+    /*
+    * Method: Erase
+    * Parameters: aValue is erased value (equal by operator== to the stored one)
+    */
+    void Erase(const TValue& aValue) {
+        TCell cell;
+        bool inside = CellOf(aValue, cell);
+        auto found_cell = iCells.end();
+        std::vector<TValue>* bucket = &iOutliers;
+        if (inside) {
+            found_cell = iCells.find(cell);
+            if (found_cell == iCells.end()) return;
+            bucket = &found_cell->second;
+        }
+        auto found = std::find(bucket->begin(), bucket->end(), aValue);
+        if (found == bucket->end()) return;
+        *found = bucket->back();
+        bucket->pop_back();
+        if (inside && bucket->empty()) iCells.erase(found_cell);
+    }
+
+    /*
+    * Method: Match
+    * Return: true when the values are equal within the tolerance
+    */
+    bool Match(const TValue& aLeft, const TValue& aRight) const {
+        switch (iMode) {
+        case TToleranceMode::Absolute:
+            for (size_t axis = 0; axis < KAxes; ++axis) {
+                if (!(std::fabs(aLeft.Coordinate(axis) - aRight.Coordinate(axis)) <= iTolerance)) return false;
+            }
+            return true;
+        case TToleranceMode::Euclidean: {
+            // distance is measured in units of the tolerance, so squares of tiny tolerance and differences do not underflow to 0
+            double distance = 0;
+            for (size_t axis = 0; axis < KAxes; ++axis) {
+                double difference = (aLeft.Coordinate(axis) - aRight.Coordinate(axis)) / iTolerance;
+                distance += difference * difference;
+            }
+            return distance <= 1;
+        }
+        case TToleranceMode::Ulp:
+            for (size_t axis = 0; axis < KAxes; ++axis) {
+                double left = aLeft.Coordinate(axis), right = aRight.Coordinate(axis);
+                if (!(left == left) || !(right == right)) return false;
+                uint64_t a = uint64_t(OrderedBits(left)), b = uint64_t(OrderedBits(right));
+                if (((OrderedBits(left) >= OrderedBits(right)) ? a - b : b - a) >= uint64_t(iUlpCell)) return false;
+            }
+            return true;
+        default:
+            return aLeft == aRight;
+        }
+    }
+
+    /*
+    * Method: For each match
+    * Details: calls given function for every stored value, which matches aValue
+    * Parameters: aValue is searched value, aFunc is callable with const TValue& parameter, returning false stops the search
+    */
+    template <typename TFunc>
+    void ForEachMatch(const TValue& aValue, TFunc aFunc) const {
+        TCell center;
+        if (!CellOf(aValue, center)) return; // NaN coordinate never matches
+        size_t cells = 1;
+        for (size_t axis = 0; axis < KAxes; ++axis) cells *= 3;
+        for (size_t neighbour = 0; neighbour < cells; ++neighbour) {
+            TCell cell = center;
+            size_t offsets = neighbour;
+            bool skip = false;
+            for (size_t axis = 0; axis < KAxes; ++axis, offsets /= 3) {
+                int64_t offset = int64_t(offsets % 3) - 1;
+                if (offset != 0 && (center.iExact & (1u << axis))) skip = true; // exact axis matches only its own key
+                cell.iKey[axis] += offset;
+            }
+            if (skip) continue;
+            auto found = iCells.find(cell);
+            if (found == iCells.end()) continue;
+            for (const TValue& value : found->second) {
+                if (Match(aValue, value) && !aFunc(value)) return;
+            }
+        }
+    }
+
+    /*
+    * Method: Contains
+    * Parameters: aValue is searched value
+    * Return: true when some stored value matches aValue
+    */
+    bool Contains(const TValue& aValue) const {
+        bool found = false;
+        ForEachMatch(aValue, [&](const TValue&) { found = true; return false; });
+        return found;
+    }
+}; /* class CToleranceIndex */
+
+#endif /* __CToleranceIndex_H__ */
@@ -0,0 +1,47 @@
+#ifndef __CValidFlag_H__
+#define __CValidFlag_H__
+/*
+*  File: CValidFlag.h
+*  Brief: CValidFlag class header
+*  Details: File contain validity flag of views, which CSet builds on demand in const methods.
+*  Author: Martin Bezecny
+*/
+
+#include <atomic>
+
+/*
+ * CValidFlag class
+ * Details: Const methods of one set can run in several threads, so view built on demand is published by setting the flag (release)
+ * after it was built under lock of the set and readers check the flag (acquire) before they read the view without lock.
+ * Flag is copied by value, so classes holding it keep their copy and move operations.
+ */
+class CValidFlag
+	{
+    std::atomic<bool> iValue{ false }; ///< State of the flag
+
+public:
+    CValidFlag() = default;
+    CValidFlag(const CValidFlag& aFlag) : iValue(aFlag.Get()) {}
+    CValidFlag& operator=(const CValidFlag& aFlag) { Set(aFlag.Get()); return *this; }
+
+    /*
+    * Method: Get
+    * Return: state of the flag, view published by Set(true) is visible after it
+    */
+    bool Get() const { return iValue.load(std::memory_order_acquire); }
+
+    /*
+    * Method: Set
+    * Parameters: aValue is new state of the flag
+    */
+    void Set(bool aValue) { iValue.store(aValue, std::memory_order_release); }
+
+    /*
+    * Method: Exchange
+    * Parameters: aValue is new state of the flag
+    * Return: previous state of the flag
+    */
+    bool Exchange(bool aValue) { return iValue.exchange(aValue, std::memory_order_acq_rel); }
+	}; /* class CValidFlag */
+
+#endif /* __CValidFlag_H__ */
@@ -5,15 +5,32 @@
 * Authors: Petyovsky 2021, modified Richter and Bezecny 2021
 */
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
 #include <ctime>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <ranges>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <typeinfo>
 #include <type_traits>		// Due to: std::is_same_v<>
+#include <vector>
 
 #include "demagle.h"
 #include "CEntity.h"
 #include "CSet.h"
+#include "CConcurrentSet.h"
+#include "CParallel.h"
+#include "CPersistentSet.h"
+#include "CSetBuilder.h"
+#include "CSetExpr.h"
+#include "CSetFile.h"
 #include "check.h"
 
 using std::endl;
@@ -21,6 +38,60 @@ using std::cout;
 using std::cin;
 using std::cerr;
 
+using TValue = CSet::TValue;
+
+/*
+ * Random value
+ * Return: value with random coordinates from range <0, 1000) (with three decimal places), so values of large sets are mostly distinct
+ */
+template <typename TType = TValue>
+static TType RandomValue()
+	{
+	auto coordinate = []() { return std::rand() % 1000 + std::rand() % 1000 / 1000.0; };
+	if constexpr (TType::KAxes == 1)
+		return TType(coordinate());
+	else
+		{
+		double x = coordinate(), y = coordinate();
+		return TType(x, y, coordinate());
+		}
+	}
+
+/*
+ * Shifted value
+ * Return: value with all coordinates shifted by aShift
+ */
+template <typename TType>
+static TType Shifted(const TType& aValue, double aShift)
+	{
+	if constexpr (TType::KAxes == 1)
+		return TType(aValue.Coordinate(0) + aShift);
+	else
+		return TType(aValue.Coordinate(0) + aShift, aValue.Coordinate(1) + aShift, aValue.Coordinate(2) + aShift);
+	}
+
+/*
+ * Random subset
+ * Return: set with randomly selected values of the pool (every value with probability aPercent %)
+ */
+static CSet RandomSubset(const std::vector<TValue>& aPool, int aPercent)
+	{
+	CSet result;
+	for (const TValue& value : aPool)
+		if (std::rand() % 100 < aPercent)
+			result.add(CEntity(value));
+	return result;
+	}
+
+/*
+ * Same order
+ * Return: true when both sets hold the same values in the same order
+ */
+static bool SameOrder(const CSet& aFirst, const CSet& aSecond)
+	{
+	return std::equal(aFirst.begin(), aFirst.end(), aSecond.begin(), aSecond.end());
+	}
+
 int main(int argc, char *argv[])
 	{
 #ifdef NDEBUG
@@ -186,6 +257,481 @@ int main(int argc, char *argv[])
 			Set2 = Set1 + elem;
 			cout << "Set1 + elem: " << Set2 << endl;
 		}
+
+		{
+			cout << "------------------Set algebra------------------" << endl;
+			// set operations merge sorted views of the operands, their results have to hold the same elements (in the same order) as selected by membership tests
+			auto select = [](const CSet& aSet, const CSet& aOther, bool aPresent) {
+				CSet result;
+				for (const TValue& value : aSet)
+					if (aOther.is_element_of(CEntity(value)) == aPresent)
+						result.add(CEntity(value));
+				return result;
+			};
+			auto includes = [](const CSet& aSet, const CSet& aOther) {
+				return std::all_of(aOther.begin(), aOther.end(), [&](const TValue& aValue) { return aSet.is_element_of(CEntity(aValue)); });
+			};
+			size_t differences = 0;
+			for (int round = 0; round < 200; ++round)
+			{
+				std::vector<TValue> pool(40);
+				for (TValue& value : pool)
+					value = RandomValue();
+				CSet SetA = RandomSubset(pool, 50), SetB = RandomSubset(pool, 50 + 50 * (round % 2));
+				CSet SetS = SetB.intersection(SetA);
+				for (int pass = 0; pass < 3; ++pass) // the first pass builds sorted views, the second one reuses them, the third one follows modification
+				{
+					if (pass == 2 && !SetA.is_empty())
+						SetA.erase(CEntity(*SetA.begin()));
+					CSet symmetric = select(SetA, SetB, false);
+					symmetric += select(SetB, SetA, false);
+					differences += !SameOrder(SetA - SetB, select(SetA, SetB, false));
+					differences += !SameOrder(SetA.intersection(SetB), select(SetA, SetB, true));
+					differences += !SameOrder(SetA.symmetric_difference(SetB), symmetric);
+					differences += !SameOrder(SetA.complement(SetB), select(SetA, SetB, false));
+					differences += SetB.is_subset_of(SetA) != includes(SetB, SetA);
+					differences += SetA.is_subset_of(SetS) != includes(SetA, SetS);
+					differences += SetB.is_subset_of(SetS) != includes(SetB, SetS);
+				}
+			}
+			cout << "Results of set operations different from membership tests: " << differences << endl;
+		}
+
+		{
+			cout << "------------------Iterators------------------" << endl;
+			// range-for, iterator c'tor of std::vector and std::ranges algorithms
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			size_t counted = 0;
+			for (const TValue& value : SetA)
+				counted += SetA.is_element_of(CEntity(value));
+			cout << "Elements of set A visited by range-for: " << counted << " of " << SetA.num_of_elements() << endl;
+			std::vector<TValue> values(SetA.begin(), SetA.end());
+			cout << "Values copied into vector: " << values.size() << ", first one: " << values.front() << endl;
+			cout << "Distance of std::ranges: " << std::ranges::distance(SetA) << endl;
+			cout << "Is " << CEntity::TestValue1() << " found by std::ranges::find? " << (std::ranges::find(SetA, CEntity::TestValue1()) != SetA.end()) << endl;
+		}
+
+		{
+			cout << "------------------Parsing------------------" << endl;
+			// parse in strict and lenient mode
+			CSet SetA;
+			size_t added = SetA.parse(CEntity::TestStringSet0());
+			cout << "Parsed " << added << " elements: " << SetA << endl;
+			cout << "Parsed again " << SetA.parse(CEntity::TestStringSet0()) << " new elements." << endl;
+			try {
+				SetA.parse("[1],[2", true);
+			}
+			catch (std::invalid_argument& e)
+			{
+				cout << "Strict parse of malformed text: " << e.what() << endl;
+			}
+			cout << "Set A after failed parse has " << SetA.num_of_elements() << " elements." << endl;
+			CSet SetB;
+			SetB.parse(CEntity::TestStringSet1() + ",[x]," + CEntity::TestStringSet0(), false);
+			cout << "Lenient parse skipping malformed element: " << SetB << endl;
+			cout << "Same as parsed by c'tor: " << SetB.are_same(CSet((CEntity::TestStringSet1() + "," + CEntity::TestStringSet0()).c_str())) << endl;
+		}
+
+		{
+			cout << "------------------Formatting------------------" << endl;
+			// format_to and output operator give the same text, larger precision round-trips
+			CSet SetA(CEntity::TestStringSet0().c_str());
+			std::string text;
+			SetA.format_to(text);
+			cout << "format_to: " << text << endl;
+			std::ostringstream stream;
+			stream << SetA;
+			cout << "Same text as output operator: " << (stream.str() == text) << endl;
+			text.clear();
+			SetA.format_to(text, 40); // precision is clamped to 17 digits
+			cout << "format_to with precision 40: " << text << endl;
+			CSet SetB;
+			SetB.parse(text);
+			cout << "Set parsed back from the text is same: " << SetB.are_same(SetA) << endl;
+			text.clear();
+			SetA.format_to(text, -1);
+			SetB = CSet();
+			SetB.parse(text);
+			cout << "Set parsed back from the shortest text is same: " << SetB.are_same(SetA) << endl;
+		}
+
+		{
+			cout << "------------------Binary file------------------" << endl;
+			// CSetFile saves the set and answers queries from the mapped file
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			SetA += CSet(CEntity::TestStringSet0().c_str());
+			const char* fileName = "main_set.bin";
+			CSetFile::Save(SetA, fileName);
+			{
+				CSetFile file(fileName);
+				cout << "File holds " << file.num_of_elements() << " elements, same as the set: " << file.to_set().are_same(SetA) << endl;
+				cout << "Is " << CEntity::TestValue1() << " element of the file? " << file.is_element_of(CEntity(CEntity::TestValue1())) << endl;
+				cout << "Section smaller of the file is same: " << file.section_smaller(CEntity(CEntity::TestValue1())).are_same(SetA.section_smaller(CEntity(CEntity::TestValue1()))) << endl;
+				cout << "Section larger of the file is same: " << file.section_larger(CEntity(CEntity::TestValue1())).are_same(SetA.section_larger(CEntity(CEntity::TestValue1()))) << endl;
+			}
+			{
+				// the last sorted position is overwritten, so it points outside of the values
+				std::fstream stream(fileName, std::ios::binary | std::ios::in | std::ios::out);
+				uint64_t position = std::numeric_limits<uint64_t>::max();
+				stream.seekp(-std::streamoff(sizeof(position)), std::ios::end);
+				stream.write(reinterpret_cast<const char*>(&position), sizeof(position));
+			}
+			try {
+				CSetFile file(fileName);
+				file.section_smaller(CEntity(Shifted(CEntity::TestValue1(), 1000)));
+			}
+			catch (std::runtime_error& e)
+			{
+				cout << "Query of broken file: " << e.what() << endl;
+			}
+			std::remove(fileName);
+			try {
+				CSetFile file(fileName);
+			}
+			catch (std::runtime_error& e)
+			{
+				cout << "Removed file can not be opened: " << e.what() << endl;
+			}
+		}
+
+		{
+			cout << "------------------Builder------------------" << endl;
+			// CSetBuilder fed by chunks, which split the elements, with and without spilling into temporary files
+			std::string input = CEntity::TestStringSet1() + "," + CEntity::TestStringSet0();
+			CSet parsed(input.c_str());
+			CSetBuilder builder, spilling(true, 2);
+			for (size_t i = 0; i < input.size(); i += 5)
+			{
+				builder.feed(std::string_view(input).substr(i, 5));
+				spilling.feed(std::string_view(input).substr(i, 5));
+			}
+			CSet built = builder.finish();
+			cout << "Set built by chunks: " << built << endl;
+			cout << "Built set is same as parsed one: " << built.are_same(parsed) << endl;
+			CSet merged = spilling.finish();
+			cout << "Set built from spilled runs: " << merged << endl;
+			cout << "Merged set is same as parsed one: " << merged.are_same(parsed) << endl;
+			// many more runs than merged at once, so they are merged in several passes
+			std::vector<TValue> pool(300);
+			for (TValue& value : pool)
+				value = RandomValue();
+			CSet random = RandomSubset(pool, 100);
+			std::string text;
+			random.format_to(text, -1);
+			CSetBuilder passes(true, 2);
+			for (size_t i = 0; i < text.size(); i += 7)
+				passes.feed(std::string_view(text).substr(i, 7));
+			cout << "Set merged in passes is same as formatted one: " << passes.finish().are_same(random) << endl;
+			try {
+				builder.feed("[1],[2");
+				builder.finish();
+			}
+			catch (std::invalid_argument& e)
+			{
+				cout << "Builder with unterminated input: " << e.what() << endl;
+			}
+			// element without closing ] is not kept in memory for ever
+			CSetBuilder endless;
+			try {
+				endless.feed("[1");
+				for (int i = 0; i < 100; ++i)
+					endless.feed("0000000000");
+				cout << "Builder kept endless element" << endl;
+			}
+			catch (std::invalid_argument& e)
+			{
+				cout << "Builder with endless element: " << e.what() << endl;
+			}
+		}
+
+		{
+			cout << "------------------Range queries------------------" << endl;
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			SetA += CSet(CEntity::TestStringSet0().c_str());
+			CEntity low(CEntity::TestValue0()), high(CEntity::TestValue1());
+			cout << "Set A: " << SetA << endl;
+			cout << "Section <" << CEntity::TestValue0() << ", " << CEntity::TestValue1() << ">: " << SetA.section(low, high) << endl;
+			cout << "Section (" << CEntity::TestValue0() << ", " << CEntity::TestValue1() << "): " << SetA.section(low, high, false, false) << endl;
+			cout << "Count in range <" << CEntity::TestValue0() << ", " << CEntity::TestValue1() << ">: " << SetA.count_in_range(low, high) << endl;
+			cout << "Count in range (" << CEntity::TestValue0() << ", " << CEntity::TestValue1() << "): " << SetA.count_in_range(low, high, false, false) << endl;
+			cout << "Section smaller and larger than " << CEntity::TestValue1() << " cover the set: "
+				<< (SetA.section_smaller(high).num_of_elements() + SetA.section_larger(high).num_of_elements() + SetA.is_element_of(high) == SetA.num_of_elements()) << endl;
+		}
+
+		{
+			cout << "------------------Batch membership------------------" << endl;
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			SetA += CSet(CEntity::TestStringSet0().c_str());
+			std::vector<TValue> probes{ CEntity::TestValue0(), CEntity::TestValue1(), Shifted(CEntity::TestValue1(), 1000) };
+			cout << "Mask of contained probes: " << SetA.contains_many(probes) << endl;
+			std::vector<TValue> all(SetA.begin(), SetA.end());
+			cout << "All elements are contained: " << (SetA.contains_many(all) == (uint64_t(1) << all.size()) - 1) << endl;
+			CSet SetB(SetA);
+			cout << "Double inversion keeps the set: " << SetA.are_same(-(-SetB)) << endl;
+		}
+
+		{
+			cout << "------------------Distance queries------------------" << endl;
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			SetA += CSet(CEntity::TestStringSet0().c_str());
+			CEntity center(CEntity::TestValue1());
+			cout << "Within 1 from " << CEntity::TestValue1() << ": " << SetA.within(center, 1) << endl;
+			cout << "Within infinite radius has all elements: " << SetA.within(center, std::numeric_limits<double>::infinity()).are_same(SetA) << endl;
+			try {
+				SetA.within(center, -1);
+			}
+			catch (std::invalid_argument& e)
+			{
+				cout << "Within negative radius: " << e.what() << endl;
+			}
+		}
+
+		{
+			cout << "------------------Spatial index------------------" << endl;
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			SetA += CSet(CEntity::TestStringSet0().c_str());
+			CEntity low(CEntity::TestValue0()), high(CEntity::TestValue1());
+			CEntity nearestScan = SetA.nearest(high);
+			CSet boxScan = SetA.box(low, high);
+			SetA.spatial_index(0.5);
+			cout << "Nearest to " << CEntity::TestValue1() << ": " << SetA.nearest(high).Value() << ", same as by scan: " << (SetA.nearest(high).Value() == nearestScan.Value()) << endl;
+			cout << "Three nearest to " << CEntity::TestValue1() << ": " << SetA.nearest(high, 3) << endl;
+			cout << "Box <" << CEntity::TestValue0() << ", " << CEntity::TestValue1() << ">: " << SetA.box(low, high) << ", same as by scan: " << SetA.box(low, high).are_same(boxScan) << endl;
+			CSet SetB(SetA); // copy keeps the grid enabled
+			SetB.add(CEntity(Shifted(CEntity::TestValue1(), 0.125)));
+			cout << "Nearest to " << CEntity::TestValue1() << " in the copy with added element: " << SetB.nearest(high, 2) << endl;
+			CSet SetC(CEntity::TestStringSet0().c_str());
+			CSet SetD = SetA - SetC; // result inherits the grid of set A
+			CSet SetE = CSet(CEntity::TestStringSet1().c_str()) - SetC;
+			cout << "Box of the difference with inherited grid is same as by scan: " << SetD.box(low, high).are_same(SetE.box(low, high)) << endl;
+			cout << "Nearest in the lazy difference is same as by scan: " << (lazy(SetA) - SetC).evaluate().nearest(high, 2).are_same(SetE.nearest(high, 2)) << endl;
+		}
+
+		{
+			cout << "------------------Tolerance------------------" << endl;
+			CSet SetA(CEntity::TestStringSet1().c_str());
+			SetA += CSet(CEntity::TestStringSet0().c_str());
+			CSet SetC(SetA);
+			TValue close = Shifted(CEntity::TestValue1(), 1e-12);
+			cout << "Is shifted element of the set (exact)? " << SetC.is_element_of(CEntity(close)) << endl;
+			SetC.tolerance(TToleranceMode::Absolute, 1e-9);
+			cout << "Is shifted element of the set (absolute tolerance 1e-9)? " << SetC.is_element_of(CEntity(close)) << endl;
+			SetC.add(CEntity(close));
+			cout << "Number of elements after addition of shifted element: " << SetC.num_of_elements() << " (before " << SetA.num_of_elements() << ")" << endl;
+			SetC.tolerance(TToleranceMode::Ulp, 4);
+			cout << "Is shifted element of the set (4 ulp)? " << SetC.is_element_of(CEntity(close)) << endl;
+			SetC.erase(CEntity(close));
+			cout << "Is " << CEntity::TestValue1() << " element of the set after erasure of shifted element (4 ulp)? " << SetC.is_element_of(CEntity(CEntity::TestValue1())) << endl;
+			// results inherit tolerance of the left operand in all branches (including early exits and lazy expressions)
+			SetC.tolerance(TToleranceMode::Absolute, 1e-9);
+			CEntity low(CEntity::TestValue0()), high(CEntity::TestValue1());
+			CSet Other(low), Empty;
+			size_t unmatched = 0;
+			for (const CSet& result : { SetC - Empty, SetC - Other, SetC.intersection(SetA - Other), SetC.intersection(SetA), SetC.symmetric_difference(Empty),
+				SetC + Empty, SetC.section(low, high), SetC.within(high, 1), CSet(SetC) - Other, CSet(lazy(SetC) - Other) })
+				unmatched += !result.is_element_of(CEntity(close));
+			cout << "Results of operations not matching shifted element (absolute tolerance 1e-9): " << unmatched << endl;
+		}
+
+		{
+			cout << "------------------Concurrent set------------------" << endl;
+			// writers add and erase their own values, while readers search stable values and the erased ones
+			const size_t KStable = 1000, KWriters = 4, KReaders = 4, KPerWriter = 1000;
+			CSet Distinct;
+			while (Distinct.num_of_elements() < KStable + KWriters * KPerWriter)
+				Distinct.add(CEntity(RandomValue()));
+			std::vector<TValue> values(Distinct.begin(), Distinct.end());
+			CConcurrentSet Shared;
+			CSet Stable;
+			for (size_t i = 0; i < KStable; ++i)
+			{
+				Shared.add(values[i]);
+				Stable.add(CEntity(values[i]));
+			}
+			std::atomic<bool> stop{ false };
+			std::atomic<size_t> errors{ 0 }, found{ 0 };
+			std::vector<std::thread> threads;
+			for (size_t w = 0; w < KWriters; ++w)
+				threads.emplace_back([&, w]() {
+					size_t first = KStable + w * KPerWriter;
+					for (int round = 0; round < 20; ++round)
+					{
+						for (size_t i = first; i < first + KPerWriter; ++i)
+							errors += !Shared.add(values[i]);
+						for (size_t i = first; i < first + KPerWriter; ++i)
+							errors += !Shared.erase(values[i]);
+					}
+				});
+			for (size_t r = 0; r < KReaders; ++r)
+				threads.emplace_back([&]() {
+					do
+					{
+						for (size_t i = 0; i < values.size(); ++i)
+						{
+							bool present = Shared.is_element_of(values[i]);
+							if (i < KStable)
+								errors += !present;
+							else
+								found += present;
+						}
+					} while (!stop);
+				});
+			for (size_t w = 0; w < KWriters; ++w)
+				threads[w].join();
+			stop = true;
+			for (size_t r = KWriters; r < threads.size(); ++r)
+				threads[r].join();
+			cout << "Errors of concurrent add, erase and is_element_of: " << errors << endl;
+			cout << "Number of elements after writers finished: " << Shared.num_of_elements() << endl;
+			cout << "Snapshot is same as stable values: " << Shared.snapshot().are_same(Stable) << endl;
+			CConcurrentSet Copied(Stable);
+			cout << "Set created from the snapshot has " << Copied.num_of_elements() << " elements." << endl;
+		}
+
+		{
+			cout << "------------------Parallel set operations------------------" << endl;
+			// the same random operands are processed by one thread and by four threads, results have to be the same (including order)
+			size_t differences = 0;
+			for (int round = 0; round < 3; ++round)
+			{
+				std::vector<TValue> pool(100000);
+				for (TValue& value : pool)
+					value = RandomValue();
+				CSet SetA = RandomSubset(pool, 75), SetB = RandomSubset(pool, 75);
+				CSet SetS = SetA.intersection(SetB);
+				std::vector<int> flags;
+				auto run = [&]() {
+					CSet SetC(SetA);
+					SetC += SetB;
+					std::vector<CSet> results{ SetA + SetB, SetA - SetB, SetA.intersection(SetB), SetA.complement(SetB), SetA.symmetric_difference(SetB), -CSet(SetA), std::move(SetC) };
+					flags.push_back(SetS.is_subset_of(SetA) + 2 * SetA.is_subset_of(SetB) + 4 * SetA.are_same(CSet(SetA)) + 8 * SetA.are_same(SetB));
+					return results;
+				};
+				CParallel::Use(1);
+				std::vector<CSet> serial = run();
+				CParallel::Use(4);
+				std::vector<CSet> parallel = run();
+				for (size_t i = 0; i < serial.size(); ++i)
+					differences += !SameOrder(serial[i], parallel[i]);
+				differences += flags[0] != flags[1];
+			}
+			// loops nested in chunks of other loop share the pool of threads
+			std::atomic<size_t> visited{ 0 };
+			CParallel::For(4, 1, [&](size_t aBegin, size_t aEnd) {
+				for (size_t i = aBegin; i < aEnd; ++i)
+					CParallel::For(4, 1, [&](size_t aFirst, size_t aLast) { visited += aLast - aFirst; });
+			});
+			differences += visited != 16;
+			CParallel::Use(0);
+			cout << "Results of parallel operations different from serial ones: " << differences << endl;
+		}
+
+		{
+			cout << "------------------Persistent set------------------" << endl;
+			// random additions and erasures are applied to persistent set and to plain set, older versions have to stay unchanged
+			std::vector<TValue> pool(200);
+			for (TValue& value : pool)
+				value = RandomValue();
+			CPersistentSet Version;
+			CSet Model;
+			std::vector<CPersistentSet> versions;
+			std::vector<CSet> models;
+			size_t differences = 0;
+			for (int step = 0; step < 3000; ++step)
+			{
+				const TValue& value = pool[std::rand() % pool.size()];
+				if (std::rand() % 3)
+				{
+					Version = Version.add(value);
+					Model.add(CEntity(value));
+				}
+				else
+				{
+					Version = Version.erase(value);
+					Model.erase(CEntity(value));
+				}
+				differences += Version.num_of_elements() != Model.num_of_elements();
+				if (step % 100 == 0)
+				{
+					differences += !Version.snapshot().are_same(Model);
+					versions.push_back(Version);
+					models.push_back(Model);
+				}
+			}
+			for (size_t i = 0; i < versions.size(); ++i)
+			{
+				differences += !versions[i].snapshot().are_same(models[i]);
+				std::vector<TValue> added, removed;
+				Version.diff(versions[i], added, removed);
+				differences += Model.complement(models[i]).num_of_elements() + models[i].complement(Model).num_of_elements() != added.size() + removed.size();
+				for (const TValue& value : added)
+					differences += !Model.is_element_of(CEntity(value)) || models[i].is_element_of(CEntity(value));
+				for (const TValue& value : removed)
+					differences += Model.is_element_of(CEntity(value)) || !models[i].is_element_of(CEntity(value));
+			}
+			cout << "Differences of persistent versions from plain sets: " << differences << endl;
+			CPersistentSet Older = Version, Newer = Version.add(RandomValue());
+			cout << "Older version shares structure: " << Older.shares(Version) << ", newer one: " << Newer.shares(Version) << endl;
+			CPersistentSet Written(CSet(CEntity::TestStringSet1().c_str())), Read;
+			std::stringstream stream;
+			stream << Written;
+			stream >> Read;
+			cout << "Persistent set read back from text: " << Read << ", same: " << (Read == Written) << endl;
+		}
+
+		{
+			cout << "------------------Lazy expressions------------------" << endl;
+			// random expressions are evaluated lazily and eagerly, results have to be the same (including order)
+			size_t differences = 0;
+			for (int round = 0; round < 200; ++round)
+			{
+				std::vector<TValue> pool(40);
+				for (TValue& value : pool)
+					value = RandomValue();
+				CSet SetA = RandomSubset(pool, 50), SetB = RandomSubset(pool, 50), SetC = RandomSubset(pool, 50);
+				CEntity low(pool[std::rand() % pool.size()]), high(pool[std::rand() % pool.size()]);
+				auto first = lazy(SetA) + SetB - SetC;
+				auto second = lazy(SetA).intersection(SetB).symmetric_difference(SetC);
+				auto third = (lazy(SetC) + SetA).complement(SetB).section(low, high);
+				auto fourth = (SetA - lazy(SetB)).section_larger(low) + lazy(SetC).section_smaller(high);
+				CSet expected[] = { SetA + SetB - SetC, SetA.intersection(SetB).symmetric_difference(SetC), (SetC + SetA).complement(SetB).section(low, high),
+					(SetA - SetB).section_larger(low) + SetC.section_smaller(high) };
+				CSet evaluated[] = { first, second, third, fourth };
+				for (int i = 0; i < 4; ++i)
+					differences += !SameOrder(evaluated[i], expected[i]);
+				differences += first.num_of_elements() != expected[0].num_of_elements();
+				differences += second.is_empty() != expected[1].is_empty();
+				for (const TValue& value : pool)
+					differences += third.is_element_of(value) != expected[2].is_element_of(CEntity(value));
+			}
+			cout << "Results of lazy expressions different from eager ones: " << differences << endl;
+		}
+
+		{
+			cout << "------------------Element types------------------" << endl;
+			// helper classes are templates over element type as CSetT, so both types can be used in one program
+			auto differences = [](const auto& aSet, const char* aFileName) {
+				using TElement = typename std::remove_cvref_t<decltype(aSet)>::TValue;
+				size_t count = !CConcurrentSetT<TElement>(aSet).snapshot().are_same(aSet);
+				count += !CPersistentSetT<TElement>(aSet).snapshot().are_same(aSet);
+				std::string text;
+				aSet.format_to(text, -1);
+				CSetBuilderT<TElement> builder;
+				builder.feed(text);
+				count += !builder.finish().are_same(aSet);
+				CSetFileT<TElement>::Save(aSet, aFileName);
+				{
+					CSetFileT<TElement> file(aFileName);
+					count += !file.to_set().are_same(aSet);
+				}
+				std::remove(aFileName);
+				return count;
+			};
+			CSetT<CEntity_CDouble::CDouble> Doubles(CEntity_CDouble::CEntity::TestStringSet1().c_str());
+			CSetT<CEntity_TPoint::TPoint> Points(CEntity_TPoint::CEntity::TestStringSet1().c_str());
+			cout << "Differences of helper classes from sets of doubles: " << differences(Doubles, "main_doubles.bin") << endl;
+			cout << "Differences of helper classes from sets of points: " << differences(Points, "main_points.bin") << endl;
+		}
 		cout << "Done." << endl;
 		} /* try */
 